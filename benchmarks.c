@@ -0,0 +1,646 @@
+#include "benchmarks.h"
+#include "rabbitsandfoxes.h"
+#include "matrix_utils.h"
+#include "movements.h"
+#include "neighbour_kernel.h"
+#include "perf_counters.h"
+#include "threads.h"
+#include <jemalloc/jemalloc.h>
+#include <string.h>
+#include <sys/time.h>
+
+//Each benchmark is repeated until it has run for at least this long
+#define BENCHMARK_MICROS 200000
+
+//How many decisions the decision benchmarks make in each pass
+#define DECISIONS (1 << 20)
+
+static long elapsedMicros(struct timeval *start) {
+    struct timeval end;
+
+    gettimeofday(&end, NULL);
+
+    return (end.tv_sec - start->tv_sec) * 1000000 + (end.tv_usec - start->tv_usec);
+}
+
+static World *readBenchmarkWorld(FILE *inputFile, InputData **dataDest) {
+
+    InputData *data = readInputData(inputFile);
+
+    data->threads = 1;
+    data->engine = SLOT_ENGINE;
+    data->neighbourKernel = getNeighbourKernel(getBestNeighbourKernel());
+
+    World *world = initWorld(data);
+
+    readWorldInitialData(inputFile, data, world);
+
+    *dataDest = data;
+
+    return world;
+}
+
+//Mix the moves found for an animal into the checksum, so every way of finding them can be compared
+static unsigned long mixDirections(unsigned long checksum, int count, MoveDirection *directions) {
+    checksum = checksum * 31 + count;
+
+    for (int i = 0; i < count; i++) {
+        checksum = checksum * 31 + directions[i];
+    }
+
+    return checksum;
+}
+
+static unsigned long mixFoxMovements(unsigned long checksum, struct FoxMovements *movements) {
+    if (movements->rabbitMovements > 0) {
+        return mixDirections(checksum, movements->rabbitMovements, movements->rabbitDirections);
+    }
+
+    return mixDirections(checksum * 7, movements->emptyMovements, movements->emptyDirections);
+}
+
+static unsigned long classifyPerEntity(InputData *data, World *world, int *animals, long animalCount) {
+
+    unsigned long checksum = 0;
+
+    struct RabbitMovements rabbitMovements;
+    struct FoxMovements foxMovements;
+
+    for (long animal = 0; animal < animalCount; animal++) {
+
+        int row = animals[animal] / data->columns, col = animals[animal] % data->columns;
+
+        if (world->slotContent[PROJECT(data->columns, row, col)] == RABBIT) {
+            getPossibleRabbitMovements(row, col, data, world, &rabbitMovements);
+
+            checksum = mixDirections(checksum, rabbitMovements.emptyMovements, rabbitMovements.emptyDirections);
+        } else {
+            getPossibleFoxMovements(row, col, data, world, &foxMovements);
+
+            checksum = mixFoxMovements(checksum, &foxMovements);
+        }
+    }
+
+    return checksum;
+}
+
+static unsigned long classifyWithKernel(InputData *data, World *world, int *animals, long animalCount,
+                                        NeighbourKernel kernel) {
+
+    unsigned long checksum = 0;
+
+    struct RabbitMovements rabbitMovements;
+    struct FoxMovements foxMovements;
+
+    uint8_t rabbitMasks[KERNEL_SEGMENT], emptyMasks[KERNEL_SEGMENT];
+
+    int segmentRow = -1, segmentStart = -1;
+
+    for (long animal = 0; animal < animalCount; animal++) {
+
+        int row = animals[animal] / data->columns, col = animals[animal] % data->columns;
+
+        //Only the segments with animals are classified, like in the generation
+        if (row != segmentRow || col - segmentStart >= KERNEL_SEGMENT) {
+            segmentRow = row;
+            segmentStart = col & ~(KERNEL_SEGMENT - 1);
+
+            kernel(world, row, segmentStart, rabbitMasks, emptyMasks);
+        }
+
+        int slot = col - segmentStart;
+
+        if (world->slotContent[PROJECT(data->columns, row, col)] == RABBIT) {
+            getRabbitMovementsFromMask(emptyMasks[slot], &rabbitMovements);
+
+            checksum = mixDirections(checksum, rabbitMovements.emptyMovements, rabbitMovements.emptyDirections);
+        } else {
+            getFoxMovementsFromMasks(rabbitMasks[slot], emptyMasks[slot], &foxMovements);
+
+            checksum = mixFoxMovements(checksum, &foxMovements);
+        }
+    }
+
+    return checksum;
+}
+
+static void reportClassification(FILE *outputFile, const char *name, long micros, int passes, long animals,
+                                 unsigned long checksum, unsigned long expected) {
+
+    double nanosPerAnimal = animals > 0 ? (micros * 1000.0) / ((double) passes * animals) : 0;
+
+    fprintf(outputFile, "  %-12s %8.2f ns per animal (%d passes)%s\n", name, nanosPerAnimal, passes,
+            checksum == expected ? "" : " CHECKSUM MISMATCH");
+}
+
+void benchmarkNeighbourKernels(FILE *inputFile, FILE *outputFile) {
+
+    InputData *data;
+
+    World *world = readBenchmarkWorld(inputFile, &data);
+
+    long animals = 0;
+
+    //The row major keys of the animals, so the benchmarks don't include going through the empty slots
+    int *animalKeys = malloc(sizeof(int) * ((size_t) data->rows * data->columns));
+
+    for (int row = 0; row < data->rows; row++) {
+        for (int col = 0; col < data->columns; col++) {
+            uint8_t content = world->slotContent[PROJECT(data->columns, row, col)];
+
+            if (content == RABBIT || content == FOX) {
+                animalKeys[animals++] = row * data->columns + col;
+            }
+        }
+    }
+
+    fprintf(outputFile, "Neighbour classification of %ld animals (%dx%d, %s, best kernel: %s)\n", animals,
+            data->rows, data->columns, MATRIX_LAYOUT, getNeighbourKernelName(getBestNeighbourKernel()));
+
+    struct timeval start;
+
+    int passes = 0;
+
+    unsigned long expected = 0, checksum = 0;
+
+    gettimeofday(&start, NULL);
+
+    do {
+        expected = classifyPerEntity(data, world, animalKeys, animals);
+        passes++;
+    } while (elapsedMicros(&start) < BENCHMARK_MICROS);
+
+    reportClassification(outputFile, "per entity", elapsedMicros(&start), passes, animals, expected, expected);
+
+    for (NeighbourKernelType type = SCALAR_KERNEL; type < NEIGHBOUR_KERNEL_TYPES; type++) {
+
+        NeighbourKernel kernel = getNeighbourKernel(type);
+
+        if (kernel == NULL) {
+            fprintf(outputFile, "  %-12s unsupported\n", getNeighbourKernelName(type));
+            continue;
+        }
+
+        passes = 0;
+
+        gettimeofday(&start, NULL);
+
+        do {
+            checksum = classifyWithKernel(data, world, animalKeys, animals, kernel);
+            passes++;
+        } while (elapsedMicros(&start) < BENCHMARK_MICROS);
+
+        reportClassification(outputFile, getNeighbourKernelName(type), elapsedMicros(&start), passes, animals,
+                             checksum, expected);
+    }
+
+    free(animalKeys);
+    freeWorldMatrix(data, world);
+}
+
+//The way the moves and the collisions were decided before the lookup tables, as a reference
+static int chooseMoveDividing(int genNumber, int row, int col, int count) {
+    return (genNumber + row + col) % count;
+}
+
+static int survivesCollisionBranching(int genNumber, EntityInfo *moving, EntityInfo *inSlot, int byFood) {
+
+    int movingAge, slotAge;
+
+    int movingUpdated = moving->genUpdated == (genNumber & 1), slotUpdated = inSlot->genUpdated == (genNumber & 1);
+
+    if (movingUpdated && !slotUpdated) {
+        movingAge = moving->currentGenProc;
+        slotAge = inSlot->currentGenProc + 1;
+    } else if (!movingUpdated && slotUpdated) {
+        movingAge = moving->currentGenProc + 1;
+        slotAge = inSlot->currentGenProc;
+    } else {
+        movingAge = moving->currentGenProc;
+        slotAge = inSlot->currentGenProc;
+    }
+
+    if (movingAge > slotAge) {
+        return 1;
+    } else if (movingAge == slotAge && byFood) {
+        if (moving->currentGenFood >= inSlot->currentGenFood) {
+            return 0;
+        } else {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+//A small generator (xorshift), so the decisions are the same in every run. Its low bits don't repeat with a short
+//period, which the branch predictor would learn
+static unsigned int nextRandom(unsigned int *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
+
+struct DecisionData {
+
+    int *sums;
+
+    uint8_t *counts;
+
+    EntityInfo *moving, *inSlot;
+
+};
+
+static unsigned long decideMoves(struct DecisionData *decisions, int table) {
+    unsigned long checksum = 0;
+
+    for (int i = 0; i < DECISIONS; i++) {
+        //The sum is split between the generation and the column, like in a tick
+        if (table) {
+            checksum += chooseMove(decisions->sums[i], 0, 0, decisions->counts[i]);
+        } else {
+            checksum += chooseMoveDividing(decisions->sums[i], 0, 0, decisions->counts[i]);
+        }
+    }
+
+    return checksum;
+}
+
+static unsigned long decideCollisions(struct DecisionData *decisions, int branchFree) {
+    unsigned long checksum = 0;
+
+    for (int i = 0; i < DECISIONS; i++) {
+        if (branchFree) {
+            checksum += survivesCollision(decisions->sums[i], &decisions->moving[i], &decisions->inSlot[i], 1);
+        } else {
+            checksum += survivesCollisionBranching(decisions->sums[i], &decisions->moving[i], &decisions->inSlot[i],
+                                                   1);
+        }
+    }
+
+    return checksum;
+}
+
+static void benchmarkDecision(FILE *outputFile, const char *name, struct DecisionData *decisions, int variant,
+                              unsigned long (*decide)(struct DecisionData *, int), unsigned long expected) {
+
+    PerfCounters counters;
+
+    struct timeval start;
+
+    int passes = 0;
+
+    unsigned long checksum = 0;
+
+    startPerfCounters(&counters);
+
+    gettimeofday(&start, NULL);
+
+    do {
+        checksum = decide(decisions, variant);
+        passes++;
+    } while (elapsedMicros(&start) < BENCHMARK_MICROS);
+
+    long micros = elapsedMicros(&start);
+
+    stopPerfCounters(&counters);
+
+    double decisionCount = (double) passes * DECISIONS;
+
+    fprintf(outputFile, "  %-12s %6.2f ns per decision, ", name, micros * 1000.0 / decisionCount);
+
+    if (getPerfCounter(&counters, BRANCH_MISSES) < 0) {
+        fprintf(outputFile, "branch misses unavailable");
+    } else {
+        fprintf(outputFile, "%.4f branch misses per decision",
+                (double) getPerfCounter(&counters, BRANCH_MISSES) / decisionCount);
+    }
+
+    fprintf(outputFile, "%s\n", checksum == expected ? "" : " CHECKSUM MISMATCH");
+}
+
+void benchmarkDecisions(FILE *inputFile, FILE *outputFile) {
+
+    InputData *data;
+
+    World *world = readBenchmarkWorld(inputFile, &data);
+
+    struct DecisionData decisions = {
+            malloc(sizeof(int) * DECISIONS), malloc(sizeof(uint8_t) * DECISIONS),
+            malloc(sizeof(EntityInfo) * DECISIONS), malloc(sizeof(EntityInfo) * DECISIONS)
+    };
+
+    unsigned int state = 1;
+
+    //Random generations, positions and animals, with the ages and food limits of the input
+    for (int i = 0; i < DECISIONS; i++) {
+        decisions.sums[i] = (int) (nextRandom(&state) % (unsigned int) (data->n_gen + data->rows + data->columns));
+        decisions.counts[i] = 1 + nextRandom(&state) % DIRECTIONS;
+
+        EntityInfo *animals[2] = {&decisions.moving[i], &decisions.inSlot[i]};
+
+        for (int animal = 0; animal < 2; animal++) {
+            animals[animal]->slotContent = FOX;
+            animals[animal]->genUpdated = nextRandom(&state) & 1;
+            animals[animal]->currentGenProc = nextRandom(&state) % (unsigned int) (data->gen_proc_foxes + 1);
+            animals[animal]->currentGenFood = nextRandom(&state) % (unsigned int) (data->gen_food_foxes + 1);
+        }
+    }
+
+    fprintf(outputFile, "Move choice (%d decisions per pass)\n", DECISIONS);
+
+    unsigned long expected = decideMoves(&decisions, 0);
+
+    benchmarkDecision(outputFile, "divide", &decisions, 0, decideMoves, expected);
+    benchmarkDecision(outputFile, "table", &decisions, 1, decideMoves, expected);
+
+    fprintf(outputFile, "Fox collisions (%d decisions per pass)\n", DECISIONS);
+
+    expected = decideCollisions(&decisions, 0);
+
+    benchmarkDecision(outputFile, "branching", &decisions, 0, decideCollisions, expected);
+    benchmarkDecision(outputFile, "branch free", &decisions, 1, decideCollisions, expected);
+
+    free(decisions.sums);
+    free(decisions.counts);
+    free(decisions.moving);
+    free(decisions.inSlot);
+
+    freeWorldMatrix(data, world);
+}
+
+//How many times each thread count of the border benchmark is run (The fastest run is the one reported)
+#define BORDER_RUNS 3
+
+//The most threads the border benchmark is run with
+#define BORDER_MAX_THREADS 64
+
+//Read the rest of the file into memory, so it can be read again for every run
+static char *readWholeFile(FILE *inputFile, size_t *sizeDest) {
+    size_t size = 0, capacity = 1 << 16;
+
+    char *contents = malloc(capacity);
+
+    size_t read;
+
+    while ((read = fread(contents + size, 1, capacity - size, inputFile)) > 0) {
+        size += read;
+
+        if (size == capacity) {
+            capacity *= 2;
+            contents = realloc(contents, capacity);
+        }
+    }
+
+    *sizeDest = size;
+
+    return contents;
+}
+
+static long fastestRun(int threads, Engine engine, char *input, size_t size) {
+    long fastest = -1;
+
+    for (int run = 0; run < BORDER_RUNS; run++) {
+        FILE *runInput = fmemopen(input, size, "r");
+
+        long micros = timeWithThreadCount(threads, engine, runInput);
+
+        fclose(runInput);
+
+        if (fastest < 0 || micros < fastest) fastest = micros;
+    }
+
+    return fastest;
+}
+
+void benchmarkBorders(FILE *inputFile, FILE *outputFile) {
+
+    size_t size;
+
+    char *input = readWholeFile(inputFile, &size);
+
+    int rows = 0;
+
+    //The rows are the fifth number of the input
+    sscanf(input, "%*d %*d %*d %*d %d", &rows);
+
+    fprintf(outputFile, "Moves into the rows of other threads (Fastest of %d runs)\n", BORDER_RUNS);
+    fprintf(outputFile, "  %8s %16s %16s\n", "threads", "conflicts (us)", "atomic (us)");
+
+    for (int threads = 2; threads <= BORDER_MAX_THREADS && threads <= rows; threads *= 2) {
+        long conflicts = fastestRun(threads, BITBOARD_ENGINE, input, size),
+                atomic = fastestRun(threads, ATOMIC_ENGINE, input, size);
+
+        fprintf(outputFile, "  %8d %16ld %16ld %6.2fx\n", threads, conflicts, atomic, (double) conflicts / atomic);
+    }
+
+    free(input);
+}
+
+//The amount of times the world is run for each way of starting the threads
+#define POOL_RUNS 200
+
+#define POOL_THREADS 4
+
+void benchmarkPool(FILE *inputFile, FILE *outputFile) {
+
+    size_t size;
+
+    char *input = readWholeFile(inputFile, &size);
+
+    int rows = 0;
+
+    sscanf(input, "%*d %*d %*d %*d %d", &rows);
+
+    int threads = rows < POOL_THREADS ? rows : POOL_THREADS;
+
+    SimulationPool *pool = initSimulationPool(threads);
+
+    //The whole run (Reading the world included) and the part from the start of the threads, for each way
+    long newThreadsTotal = 0, newThreadsRun = 0, poolTotal = 0, poolRun = 0;
+
+    struct timeval start;
+
+    for (int run = 0; run < POOL_RUNS; run++) {
+        FILE *runInput = fmemopen(input, size, "r");
+
+        gettimeofday(&start, NULL);
+
+        newThreadsRun += timeWithThreadCount(threads, GATHER_ENGINE, runInput);
+        newThreadsTotal += elapsedMicros(&start);
+
+        fclose(runInput);
+
+        runInput = fmemopen(input, size, "r");
+
+        gettimeofday(&start, NULL);
+
+        poolRun += executeWithPool(pool, threads, GATHER_ENGINE, runInput, NULL);
+        poolTotal += elapsedMicros(&start);
+
+        fclose(runInput);
+    }
+
+    freeSimulationPool(pool);
+
+    fprintf(outputFile, "Runs of the world with %d threads (Average of %d runs)\n", threads, POOL_RUNS);
+    fprintf(outputFile, "  %-12s %12s %12s\n", "", "total (us)", "threads (us)");
+    fprintf(outputFile, "  %-12s %12.1f %12.1f\n", "new threads", (double) newThreadsTotal / POOL_RUNS,
+            (double) newThreadsRun / POOL_RUNS);
+    fprintf(outputFile, "  %-12s %12.1f %12.1f\n", "pool", (double) poolTotal / POOL_RUNS,
+            (double) poolRun / POOL_RUNS);
+
+    free(input);
+}
+
+//How many times the threads go through each barrier
+#define BARRIER_EPISODES 1000
+
+//The barriers are timed from 2 threads, doubling up to this many
+#define BARRIER_MAX_THREADS 128
+
+struct BarrierThread {
+
+    int threadNumber;
+
+    pthread_barrier_t *pthreadBarrier;
+
+    //NULL when timing pthreadBarrier
+    TreeBarrier *treeBarrier;
+};
+
+static void crossBarrier(struct BarrierThread *thread) {
+    if (thread->treeBarrier != NULL) {
+        waitAtTreeBarrier(thread->treeBarrier, thread->threadNumber);
+    } else {
+        pthread_barrier_wait(thread->pthreadBarrier);
+    }
+}
+
+static void *crossBarriers(void *arg) {
+    struct BarrierThread *thread = arg;
+
+    //Once to start together, and once for each episode
+    for (int episode = 0; episode <= BARRIER_EPISODES; episode++) {
+        crossBarrier(thread);
+    }
+
+    return NULL;
+}
+
+/**
+ * The flags of each thread must be in their own cache line, or the threads that spin on them share lines with the
+ * threads that write the flags next to them
+ */
+static void checkTreeBarrierAlignment(TreeBarrier *barrier) {
+
+    for (int node = 0; node <= barrier->threads; node++) {
+        if ((uintptr_t) &barrier->nodes[node] % 64 != 0) {
+            fprintf(stderr, "The node of thread %d of the tree barrier isn't aligned to a cache line!", node);
+
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/**
+ * @return The micros it took for the threads to go through the barrier BARRIER_EPISODES times, timed by thread 0
+ * (The calling thread) from the moment they were all started
+ */
+static long timeBarrier(int threads, int tree) {
+
+    pthread_barrier_t pthreadBarrier;
+    TreeBarrier treeBarrier;
+
+    pthread_barrier_init(&pthreadBarrier, NULL, threads);
+    initTreeBarrier(&treeBarrier, threads);
+
+    checkTreeBarrierAlignment(&treeBarrier);
+
+    pthread_t *threadIds = malloc(sizeof(pthread_t) * threads);
+    struct BarrierThread *barrierThreads = malloc(sizeof(struct BarrierThread) * threads);
+
+    for (int thread = 0; thread < threads; thread++) {
+        barrierThreads[thread].threadNumber = thread;
+        barrierThreads[thread].pthreadBarrier = &pthreadBarrier;
+        barrierThreads[thread].treeBarrier = tree ? &treeBarrier : NULL;
+
+        if (thread > 0) {
+            pthread_create(&threadIds[thread], NULL, crossBarriers, &barrierThreads[thread]);
+        }
+    }
+
+    crossBarrier(&barrierThreads[0]);
+
+    struct timeval start;
+
+    gettimeofday(&start, NULL);
+
+    for (int episode = 0; episode < BARRIER_EPISODES; episode++) {
+        crossBarrier(&barrierThreads[0]);
+    }
+
+    long micros = elapsedMicros(&start);
+
+    for (int thread = 1; thread < threads; thread++) {
+        pthread_join(threadIds[thread], NULL);
+    }
+
+    free(barrierThreads);
+    free(threadIds);
+
+    freeTreeBarrier(&treeBarrier);
+    pthread_barrier_destroy(&pthreadBarrier);
+
+    return micros;
+}
+
+void benchmarkBarriers(FILE *inputFile, FILE *outputFile) {
+
+    fprintf(outputFile, "Time per barrier (Average of %d episodes)\n", BARRIER_EPISODES);
+    fprintf(outputFile, "  %-8s %14s %14s\n", "threads", "pthread (ns)", "tree (ns)");
+
+    for (int threads = 2; threads <= BARRIER_MAX_THREADS; threads *= 2) {
+        long pthreadMicros = timeBarrier(threads, 0), treeMicros = timeBarrier(threads, 1);
+
+        fprintf(outputFile, "  %-8d %14.0f %14.0f\n", threads, pthreadMicros * 1000.0 / BARRIER_EPISODES,
+                treeMicros * 1000.0 / BARRIER_EPISODES);
+    }
+}
+
+int runBenchmark(const char *name, FILE *inputFile, FILE *outputFile) {
+
+    if (strcmp(name, "neighbours") == 0) {
+        benchmarkNeighbourKernels(inputFile, outputFile);
+
+        return 1;
+    }
+
+    if (strcmp(name, "decisions") == 0) {
+        benchmarkDecisions(inputFile, outputFile);
+
+        return 1;
+    }
+
+    if (strcmp(name, "borders") == 0) {
+        benchmarkBorders(inputFile, outputFile);
+
+        return 1;
+    }
+
+    if (strcmp(name, "pool") == 0) {
+        benchmarkPool(inputFile, outputFile);
+
+        return 1;
+    }
+
+    if (strcmp(name, "barriers") == 0) {
+        benchmarkBarriers(inputFile, outputFile);
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef TRABALHO_2_BENCHMARKS_H
+#define TRABALHO_2_BENCHMARKS_H
+
+#include <stdio.h>
+
+/**
+ * Run the microbenchmark with the name on the world read from inputFile, writing the report to outputFile
+ * (./ecosystem bench <name> < input)
+ *
+ * @return 0 if there is no benchmark with that name
+ */
+int runBenchmark(const char *name, FILE *inputFile, FILE *outputFile);
+
+/**
+ * Time the classification of the neighbours of every animal with each neighbour kernel the CPU supports,
+ * against looking at the neighbours of each animal separately (getPossibleRabbitMovements/getPossibleFoxMovements)
+ */
+void benchmarkNeighbourKernels(FILE *inputFile, FILE *outputFile);
+
+/**
+ * Time the choice of moves and the resolution of fox collisions through the lookup tables and the branch free
+ * comparison, against the division and the nested branches they replace, with the branch misses of each
+ */
+void benchmarkDecisions(FILE *inputFile, FILE *outputFile);
+
+/**
+ * Time whole runs of the world with 2 to 64 threads, handing the moves into the rows of the other threads over as
+ * conflicts (The bitboard engine) against claiming their slots right away (The atomic engine)
+ */
+void benchmarkBorders(FILE *inputFile, FILE *outputFile);
+
+/**
+ * Time many runs of the world, creating new threads for each one (timeWithThreadCount) against handing it to the
+ * parked threads of a pool (executeWithPool)
+ */
+void benchmarkPool(FILE *inputFile, FILE *outputFile);
+
+/**
+ * Time the threads going through a barrier, with 2 to 128 threads, through the tree barrier the engines use
+ * (TreeBarrier) against pthread_barrier_wait. Doesn't read inputFile
+ */
+void benchmarkBarriers(FILE *inputFile, FILE *outputFile);
+
+#endif //TRABALHO_2_BENCHMARKS_H
@@ -0,0 +1,526 @@
+#include "ensemble.h"
+#include "rabbitsandfoxes.h"
+#include "matrix_utils.h"
+#include "movements.h"
+#include <jemalloc/jemalloc.h>
+#include <ctype.h>
+#include <string.h>
+#include <sys/time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#define X86_KERNELS
+
+#endif
+
+/*
+ * A value per world. The ages and the food of the worlds are kept in 16 bits, so a vector holds ENSEMBLE_LANES of
+ * them (One AVX2 register, or two SSE2 ones). The planes are only aligned to their elements.
+ *
+ * Comparisons between lanes give a LaneMask, with every bit of a lane set where the comparison holds
+ */
+typedef int16_t Lanes __attribute__((vector_size(ENSEMBLE_LANES * sizeof(int16_t)), aligned(sizeof(int16_t))));
+
+typedef int16_t LaneMask __attribute__((vector_size(ENSEMBLE_LANES * sizeof(int16_t)), aligned(sizeof(int16_t))));
+
+//The ages and the food of an animal are bounded by the amount of generations
+#define MAX_ENSEMBLE_GENERATIONS (INT16_MAX - 1)
+
+//The decision of an animal that does not move
+#define NO_MOVE DIRECTIONS
+
+#define ENSEMBLE_SLOT(ensemble, row, col) (((row) + 1) * (ensemble)->stride + (col) + 1)
+
+#define ENSEMBLE_SLOTS(ensemble) ((size_t) ((ensemble)->rows + 2) * (ensemble)->stride)
+
+/**
+ * ENSEMBLE_LANES worlds of the same size. Same planes as World, with the values of a slot in every world together.
+ *
+ * The worlds are surrounded by a border of rocks (So a row takes up stride = columns + 2 slots), so no neighbour of
+ * a slot is ever outside of the planes, and the passes don't have to check for the edges of the world
+ */
+typedef struct Ensemble_ {
+
+    int rows, columns, stride;
+
+    Lanes *slotContent, *genUpdated, *currentGenFood, *currentGenProc;
+
+} Ensemble;
+
+/**
+ * The rules of each of the worlds of an ensemble
+ */
+typedef struct EnsembleRules_ {
+
+    Lanes genProcRabbits, genProcFoxes, genFoodFoxes;
+
+} EnsembleRules;
+
+//The same value in every lane
+#define LANES_OF(value) ((Lanes) {} + (int16_t) (value))
+
+//The lanes of ifSet where mask is set, and the ones of otherwise everywhere else
+#define SELECT_LANES(mask, ifSet, otherwise) (((Lanes) (mask) & (ifSet)) | (~(Lanes) (mask) & (otherwise)))
+
+/*
+ * Comparisons between lanes, through the sign of their difference. GCC splits the arithmetic of a vector wider than
+ * the registers of the CPU in halves, but turns its comparisons into one per lane, which makes the baseline pass 10
+ * times slower. Every value is between 0 and INT16_MAX, so the differences never overflow (And two values are equal
+ * only if the bits that differ, minus 1, are negative)
+ */
+#define LANES_LESS(a, b) ((LaneMask) (((a) - (b)) >> 15))
+
+#define LANES_AT_LEAST(a, b) (~LANES_LESS(a, b))
+
+#define LANES_EQUAL(a, b) ((LaneMask) ((((a) ^ (b)) - 1) >> 15))
+
+/*
+ * The passes of a generation are compiled for AVX2 and for the baseline instruction set, and the loader picks one
+ * with CPUID the first time they are called. The helpers above are macros so they are always compiled along with
+ * the pass that uses them (GCC splits the vector operations of a function that is compiled without AVX2 into
+ * halves, even if it's later inlined into one that is)
+ */
+#ifdef X86_KERNELS
+
+#define ENSEMBLE_KERNEL __attribute__((target_clones("avx2", "default")))
+
+#else
+
+#define ENSEMBLE_KERNEL
+
+#endif
+
+static inline int anyLane(const LaneMask *mask) {
+    uint64_t words[sizeof(LaneMask) / sizeof(uint64_t)], any = 0;
+
+    memcpy(words, mask, sizeof(LaneMask));
+
+    for (size_t word = 0; word < sizeof(LaneMask) / sizeof(uint64_t); word++) {
+        any |= words[word];
+    }
+
+    return any != 0;
+}
+
+/**
+ * Decide the move of every animal of the species in world, in every world at once (See decideMovesForRow).
+ * The decision of a slot is the direction its animal moves in, NO_MOVE if it doesn't (Or if there is none)
+ */
+ENSEMBLE_KERNEL
+static void decideEnsembleMoves(int genNumber, Ensemble *world, EnsembleRules *rules, SlotContent species,
+                                Lanes *decisions) {
+
+    int offsets[DIRECTIONS];
+
+    for (int direction = 0; direction < DIRECTIONS; direction++) {
+        offsets[direction] = DIRECTION_MOVES[direction].x * world->stride + DIRECTION_MOVES[direction].y;
+    }
+
+    for (int row = 0; row < world->rows; row++) {
+        for (int col = 0; col < world->columns; col++) {
+
+            int slot = ENSEMBLE_SLOT(world, row, col);
+
+            LaneMask isSpecies = LANES_EQUAL(world->slotContent[slot], LANES_OF(species));
+
+            decisions[slot] = LANES_OF(NO_MOVE);
+
+            if (!anyLane(&isSpecies)) continue;
+
+            LaneMask rabbits[DIRECTIONS], empty[DIRECTIONS], moves[DIRECTIONS];
+
+            for (int direction = 0; direction < DIRECTIONS; direction++) {
+                Lanes neighbour = world->slotContent[slot + offsets[direction]];
+
+                rabbits[direction] = LANES_EQUAL(neighbour, LANES_OF(RABBIT));
+                empty[direction] = LANES_EQUAL(neighbour, LANES_OF(EMPTY));
+            }
+
+            LaneMask moving = isSpecies;
+
+            if (species == FOX) {
+                LaneMask anyRabbit = rabbits[NORTH] | rabbits[EAST] | rabbits[SOUTH] | rabbits[WEST];
+
+                //Same as tickFox: the food is incremented before checking if the fox starves
+                moving &= anyRabbit | LANES_LESS(world->currentGenFood[slot] + 1, rules->genFoodFoxes);
+
+                //Foxes always go for a rabbit when they can
+                for (int direction = 0; direction < DIRECTIONS; direction++) {
+                    moves[direction] = (LaneMask) SELECT_LANES(anyRabbit, (Lanes) rabbits[direction],
+                                                              (Lanes) empty[direction]);
+                }
+            } else {
+                for (int direction = 0; direction < DIRECTIONS; direction++) {
+                    moves[direction] = empty[direction];
+                }
+            }
+
+            Lanes count = -(Lanes) (moves[NORTH] + moves[EAST] + moves[SOUTH] + moves[WEST]);
+
+            //chooseMove, with the row of MOVE_CHOICE of this slot (Which is the same in every world)
+            const uint8_t *choices = MOVE_CHOICE[(unsigned int) (genNumber + row + col) % MOVE_CYCLE];
+
+            Lanes choice = LANES_OF(choices[0]);
+
+            for (int moveCount = 1; moveCount <= DIRECTIONS; moveCount++) {
+                choice = SELECT_LANES(LANES_EQUAL(count, LANES_OF(moveCount)), LANES_OF(choices[moveCount]), choice);
+            }
+
+            //The chosen move is the possible one with choice possible moves before it (See MASK_DIRECTIONS)
+            Lanes decision = LANES_OF(NO_MOVE), before = LANES_OF(0);
+
+            for (int direction = 0; direction < DIRECTIONS; direction++) {
+                decision = SELECT_LANES(moves[direction] & LANES_EQUAL(before, choice), LANES_OF(direction), decision);
+
+                before -= (Lanes) moves[direction];
+            }
+
+            decisions[slot] = SELECT_LANES(moving, decision, LANES_OF(NO_MOVE));
+        }
+    }
+}
+
+/**
+ * Write nextWorld with the animals of the species of world that end up in each slot, and everything else as it is,
+ * in every world at once (See gatherRow)
+ */
+ENSEMBLE_KERNEL
+static void gatherEnsemble(int genNumber, Ensemble *world, Ensemble *nextWorld, EnsembleRules *rules,
+                           SlotContent species, Lanes *decisions) {
+
+    //The neighbours that can move into a slot, in the order their ticks run in the other engines
+    static const MoveDirection arrivalOrder[DIRECTIONS] = {NORTH, WEST, EAST, SOUTH};
+
+    Lanes updated = LANES_OF(genNumber & 1), genProc = species == RABBIT ? rules->genProcRabbits : rules->genProcFoxes;
+
+    int offsets[DIRECTIONS];
+
+    for (int direction = 0; direction < DIRECTIONS; direction++) {
+        offsets[direction] = DIRECTION_MOVES[direction].x * world->stride + DIRECTION_MOVES[direction].y;
+    }
+
+    for (int row = 0; row < world->rows; row++) {
+        for (int col = 0; col < world->columns; col++) {
+
+            int slot = ENSEMBLE_SLOT(world, row, col);
+
+            Lanes content = world->slotContent[slot], age = world->currentGenProc[slot],
+                    food = world->currentGenFood[slot], genUpdated = world->genUpdated[slot];
+
+            LaneMask own = LANES_EQUAL(content, LANES_OF(species)),
+                    moved = ~LANES_EQUAL(decisions[slot], LANES_OF(NO_MOVE));
+
+            if (species == FOX) food += (Lanes) own & 1;
+
+            //An animal that moves away leaves its child behind when it's old enough,
+            //one that doesn't stays in the slot (Unless it's a fox that starves)
+            LaneMask child = own & moved & LANES_AT_LEAST(age, genProc), stays = own & ~moved;
+
+            if (species == FOX) stays &= LANES_LESS(food, rules->genFoodFoxes);
+
+            Lanes left = SELECT_LANES(child | stays, LANES_OF(species), LANES_OF(EMPTY));
+
+            Lanes outContent = SELECT_LANES(own, left, content),
+                    outAge = SELECT_LANES(own, SELECT_LANES(child, LANES_OF(0), age + 1), age),
+                    outFood = SELECT_LANES(own & child, LANES_OF(0), food),
+                    outUpdated = SELECT_LANES(own, updated, genUpdated);
+
+            for (int arrival = 0; arrival < DIRECTIONS; arrival++) {
+                MoveDirection direction = arrivalOrder[arrival];
+
+                //The animal moves into this slot if it moves in the opposite direction of where it is
+                //(Nothing ever moves out of the border)
+                int from = slot + offsets[direction];
+
+                LaneMask arrives = LANES_EQUAL(decisions[from], LANES_OF((direction + 2) % DIRECTIONS));
+
+                if (!anyLane(&arrives)) continue;
+
+                Lanes movingAge = world->currentGenProc[from], movingFood = world->currentGenFood[from],
+                        movingUpdated = world->genUpdated[from];
+
+                if (species == FOX) movingFood += 1;
+
+                LaneMask procriated = LANES_AT_LEAST(movingAge, genProc);
+
+                movingAge = SELECT_LANES(procriated, LANES_OF(0), movingAge);
+                movingUpdated = SELECT_LANES(procriated, updated, movingUpdated);
+
+                //Same as handleMoveRabbit and handleMoveFox: it only has to win a collision with its own species,
+                //which is decided like in survivesCollision
+                LaneMask collides = LANES_EQUAL(outContent, LANES_OF(species));
+
+                LaneMask movingIsUpdated = LANES_EQUAL(movingUpdated, updated),
+                        slotIsUpdated = LANES_EQUAL(outUpdated, updated);
+
+                //The masks are -1 where they are set, so subtracting them adds 1 to the age
+                Lanes movingKey = movingAge - (Lanes) (~movingIsUpdated & slotIsUpdated),
+                        slotKey = outAge - (Lanes) (movingIsUpdated & ~slotIsUpdated);
+
+                LaneMask survives = LANES_LESS(slotKey, movingKey);
+
+                if (species == FOX) survives |= LANES_EQUAL(movingKey, slotKey) & LANES_LESS(movingFood, outFood);
+
+                LaneMask takes = arrives & (~collides | survives);
+
+                //A fox that moves into a rabbit eats it
+                if (species == FOX) {
+                    movingFood = SELECT_LANES(LANES_EQUAL(outContent, LANES_OF(RABBIT)), LANES_OF(0), movingFood);
+                }
+
+                outContent = SELECT_LANES(takes, LANES_OF(species), outContent);
+                outAge = SELECT_LANES(takes, SELECT_LANES(procriated, movingAge, movingAge + 1), outAge);
+                outFood = SELECT_LANES(takes, movingFood, outFood);
+                outUpdated = SELECT_LANES(takes, updated, outUpdated);
+            }
+
+            nextWorld->slotContent[slot] = outContent;
+            nextWorld->currentGenProc[slot] = outAge;
+            nextWorld->currentGenFood[slot] = outFood;
+            nextWorld->genUpdated[slot] = outUpdated;
+        }
+    }
+}
+
+static void performEnsembleGeneration(int genNumber, Ensemble *world, Ensemble *nextWorld, EnsembleRules *rules,
+                                      Lanes *decisions) {
+
+    decideEnsembleMoves(genNumber, world, rules, RABBIT, decisions);
+    gatherEnsemble(genNumber, world, nextWorld, rules, RABBIT, decisions);
+
+    decideEnsembleMoves(genNumber, nextWorld, rules, FOX, decisions);
+    gatherEnsemble(genNumber, nextWorld, world, rules, FOX, decisions);
+}
+
+/**
+ * The instruction set the passes of the generation run with on this CPU
+ */
+static const char *getEnsembleInstructionSet(void) {
+
+#ifdef X86_KERNELS
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        return "avx2";
+    }
+#endif
+
+    return "default";
+}
+
+static void initEnsemble(Ensemble *ensemble, int rows, int columns) {
+    ensemble->rows = rows;
+    ensemble->columns = columns;
+    ensemble->stride = columns + 2;
+
+    size_t slots = ENSEMBLE_SLOTS(ensemble);
+
+    ensemble->slotContent = allocPages(sizeof(Lanes) * 4 * slots);
+    ensemble->genUpdated = ensemble->slotContent + slots;
+    ensemble->currentGenFood = ensemble->genUpdated + slots;
+    ensemble->currentGenProc = ensemble->currentGenFood + slots;
+
+    //The inside of the border is written in every phase, the border itself never is
+    for (size_t slot = 0; slot < slots; slot++) {
+        ensemble->slotContent[slot] = LANES_OF(ROCK);
+    }
+}
+
+//A rule below 0 works like 0 and one above the generations never applies, so the rules fit in the lanes
+static inline int16_t clampRule(int value) {
+    return value < 0 ? 0 : value > INT16_MAX ? INT16_MAX : (int16_t) value;
+}
+
+/**
+ * Interleave the worlds into the lanes of the ensemble. The lanes without a world are left empty
+ */
+static void loadEnsemble(Ensemble *ensemble, EnsembleRules *rules, InputData **data, World **worlds, int count) {
+
+    for (int row = 0; row < ensemble->rows; row++) {
+        Lanes *planes[] = {ensemble->slotContent, ensemble->genUpdated, ensemble->currentGenFood,
+                           ensemble->currentGenProc};
+
+        for (int plane = 0; plane < 4; plane++) {
+            memset(&planes[plane][ENSEMBLE_SLOT(ensemble, row, 0)], 0, sizeof(Lanes) * ensemble->columns);
+        }
+    }
+
+    rules->genProcRabbits = rules->genProcFoxes = rules->genFoodFoxes = LANES_OF(INT16_MAX);
+
+    for (int lane = 0; lane < count; lane++) {
+
+        rules->genProcRabbits[lane] = clampRule(data[lane]->gen_proc_rabbits);
+        rules->genProcFoxes[lane] = clampRule(data[lane]->gen_proc_foxes);
+        rules->genFoodFoxes[lane] = clampRule(data[lane]->gen_food_foxes);
+
+        for (int row = 0; row < ensemble->rows; row++) {
+            for (int col = 0; col < ensemble->columns; col++) {
+                int slot = ENSEMBLE_SLOT(ensemble, row, col), worldSlot = PROJECT(ensemble->columns, row, col);
+
+                ensemble->slotContent[slot][lane] = worlds[lane]->slotContent[worldSlot];
+                ensemble->genUpdated[slot][lane] = worlds[lane]->genUpdated[worldSlot];
+                ensemble->currentGenFood[slot][lane] = worlds[lane]->currentGenFood[worldSlot];
+                ensemble->currentGenProc[slot][lane] = (int16_t) worlds[lane]->currentGenProc[worldSlot];
+            }
+        }
+    }
+}
+
+/**
+ * Write the lanes of the ensemble back into their worlds, counting the entities of each one
+ */
+static void storeEnsemble(Ensemble *ensemble, InputData **data, World **worlds, int count) {
+
+    for (int lane = 0; lane < count; lane++) {
+
+        int entities = 0;
+
+        for (int row = 0; row < ensemble->rows; row++) {
+            for (int col = 0; col < ensemble->columns; col++) {
+                int slot = ENSEMBLE_SLOT(ensemble, row, col);
+
+                EntityInfo entity = {
+                        .slotContent = (uint8_t) ensemble->slotContent[slot][lane],
+                        .genUpdated = (uint8_t) ensemble->genUpdated[slot][lane],
+                        .currentGenFood = ensemble->currentGenFood[slot][lane],
+                        .currentGenProc = ensemble->currentGenProc[slot][lane]
+                };
+
+                setEntity(worlds[lane], PROJECT(ensemble->columns, row, col), &entity);
+
+                if (entity.slotContent == EMPTY) {
+                    markEmpty(worlds[lane], row, col);
+                } else {
+                    markOccupied(worlds[lane], row, col, entity.slotContent);
+                }
+
+                entities += entity.slotContent == RABBIT || entity.slotContent == FOX;
+            }
+
+            data[lane]->entitiesAccumulatedPerRow[row] = entities;
+        }
+    }
+}
+
+static int hasAnotherWorld(FILE *inputFile) {
+    int next;
+
+    while ((next = fgetc(inputFile)) != EOF && isspace(next));
+
+    if (next == EOF) return 0;
+
+    ungetc(next, inputFile);
+
+    return 1;
+}
+
+void executeEnsemble(FILE *inputFile, FILE *outputFile) {
+
+    int worldCount = 0, capacity = ENSEMBLE_LANES;
+
+    InputData **data = malloc(sizeof(InputData *) * capacity);
+    World **worlds = malloc(sizeof(World *) * capacity);
+
+    while (hasAnotherWorld(inputFile)) {
+
+        if (worldCount == capacity) {
+            capacity *= 2;
+
+            data = realloc(data, sizeof(InputData *) * capacity);
+            worlds = realloc(worlds, sizeof(World *) * capacity);
+        }
+
+        InputData *worldData = readInputData(inputFile);
+
+        worldData->threads = 1;
+        worldData->engine = SLOT_ENGINE;
+        worldData->neighbourKernel = NULL;
+
+        if (worldCount > 0 && (worldData->rows != data[0]->rows || worldData->columns != data[0]->columns ||
+                               worldData->n_gen != data[0]->n_gen)) {
+            fprintf(stderr, "Every world of the ensemble must have the same size and amount of generations!");
+
+            exit(EXIT_FAILURE);
+        }
+
+        if (worldData->n_gen > MAX_ENSEMBLE_GENERATIONS) {
+            fprintf(stderr, "The ensemble only supports up to %d generations!", MAX_ENSEMBLE_GENERATIONS);
+
+            exit(EXIT_FAILURE);
+        }
+
+        World *world = initWorld(worldData);
+
+        readWorldInitialData(inputFile, worldData, world);
+
+        data[worldCount] = worldData;
+        worlds[worldCount] = world;
+        worldCount++;
+    }
+
+    if (worldCount == 0) {
+        free(data);
+        free(worlds);
+
+        return;
+    }
+
+    int rows = data[0]->rows, columns = data[0]->columns;
+
+    Ensemble world, nextWorld;
+
+    initEnsemble(&world, rows, columns);
+    initEnsemble(&nextWorld, rows, columns);
+
+    //Only the decisions of the slots inside the border are ever written
+    Lanes *decisions = allocPages(sizeof(Lanes) * ENSEMBLE_SLOTS(&world));
+
+    for (size_t slot = 0; slot < ENSEMBLE_SLOTS(&world); slot++) {
+        decisions[slot] = LANES_OF(NO_MOVE);
+    }
+
+    EnsembleRules rules;
+
+    struct timeval start, end;
+
+    gettimeofday(&start, NULL);
+
+    for (int first = 0; first < worldCount; first += ENSEMBLE_LANES) {
+
+        int count = worldCount - first < ENSEMBLE_LANES ? worldCount - first : ENSEMBLE_LANES;
+
+        loadEnsemble(&world, &rules, &data[first], &worlds[first], count);
+
+        for (int gen = 0; gen < data[0]->n_gen; gen++) {
+            performEnsembleGeneration(gen, &world, &nextWorld, &rules, decisions);
+        }
+
+        storeEnsemble(&world, &data[first], &worlds[first], count);
+    }
+
+    gettimeofday(&end, NULL);
+
+    long seconds = (end.tv_sec - start.tv_sec);
+    long micros = ((seconds * 1000000) + end.tv_usec) - (start.tv_usec);
+
+    for (int index = 0; index < worldCount; index++) {
+        printf("RESULTS:\n");
+
+        printResults(outputFile, data[index], worlds[index]);
+
+        freeWorldMatrix(data[index], worlds[index]);
+    }
+
+    fflush(outputFile);
+
+    printf("Took %ld microseconds\n", micros);
+    printf("Ensemble: %d worlds, %d per vector (%s)\n", worldCount, ENSEMBLE_LANES,
+           getEnsembleInstructionSet());
+
+    freePages(world.slotContent);
+    freePages(nextWorld.slotContent);
+    freePages(decisions);
+
+    free(data);
+    free(worlds);
+}
@@ -0,0 +1,21 @@
+#ifndef TRABALHO_2_ENSEMBLE_H
+#define TRABALHO_2_ENSEMBLE_H
+
+#include <stdio.h>
+
+/*
+ * The ensemble mode runs many independent worlds of the same size at once. They are stored interleaved
+ * (The values of a slot in every world next to each other), so every vector instruction of a generation
+ * works on ENSEMBLE_LANES worlds.
+ */
+#define ENSEMBLE_LANES 16
+
+/**
+ * Run every world in inputFile (One input after the other, until the end of the file), writing the results of each
+ * one to outputFile in the same order. (./ecosystem ensemble < inputs)
+ *
+ * The worlds must all have the same rows, columns and amount of generations, each one can have its own rules.
+ */
+void executeEnsemble(FILE *inputFile, FILE *outputFile);
+
+#endif //TRABALHO_2_ENSEMBLE_H
@@ -0,0 +1,206 @@
+#include "entity_index.h"
+
+#include <stdlib.h>
+
+//Short lists are sorted with an insertion sort, longer ones with a radix sort
+#define INSERTION_SORT_LIMIT 64
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+static void initEntityList(EntityList *list, int capacity) {
+    list->startRow = 0;
+    list->endRow = -1;
+    list->count = 0;
+    list->capacity = capacity;
+    list->keys = malloc(sizeof(int) * capacity);
+}
+
+EntityIndex *initEntityIndex(int partitions, int initialCapacity) {
+    EntityIndex *index = malloc(sizeof(EntityIndex));
+
+    index->partitions = partitions;
+
+    if (initialCapacity < INSERTION_SORT_LIMIT) initialCapacity = INSERTION_SORT_LIMIT;
+
+    for (int parity = 0; parity < 2; parity++) {
+        index->worldEntities[parity] = malloc(sizeof(EntityList) * partitions);
+        index->nextWorldEntities[parity] = malloc(sizeof(EntityList) * partitions);
+
+        for (int partition = 0; partition < partitions; partition++) {
+            initEntityList(&index->worldEntities[parity][partition], initialCapacity);
+            initEntityList(&index->nextWorldEntities[parity][partition], initialCapacity);
+        }
+    }
+
+    index->sortBuffers = malloc(sizeof(EntityList) * partitions);
+
+    for (int partition = 0; partition < partitions; partition++) {
+        initEntityList(&index->sortBuffers[partition], initialCapacity);
+    }
+
+    return index;
+}
+
+void clearEntityList(EntityList *list, int startRow, int endRow) {
+    list->startRow = startRow;
+    list->endRow = endRow;
+    list->count = 0;
+}
+
+void growEntityList(EntityList *list) {
+    list->capacity *= 2;
+
+    list->keys = realloc(list->keys, sizeof(int) * list->capacity);
+}
+
+static void insertionSort(int *keys, int count) {
+    for (int i = 1; i < count; i++) {
+        int key = keys[i], j = i - 1;
+
+        while (j >= 0 && keys[j] > key) {
+            keys[j + 1] = keys[j];
+            j--;
+        }
+
+        keys[j + 1] = key;
+    }
+}
+
+void sortEntityList(EntityList *list, EntityList *sortBuffer, int columns) {
+
+    if (list->count < INSERTION_SORT_LIMIT) {
+        insertionSort(list->keys, list->count);
+    } else {
+        if (sortBuffer->capacity < list->count) {
+            sortBuffer->capacity = list->capacity;
+            sortBuffer->keys = realloc(sortBuffer->keys, sizeof(int) * sortBuffer->capacity);
+        }
+
+        //All of the keys are in the rows of the list, so only sort on the bits that can differ
+        int firstKey = list->startRow * columns,
+                maxOffset = (list->endRow - list->startRow + 1) * columns - 1;
+
+        int *source = list->keys, *destination = sortBuffer->keys;
+
+        for (int shift = 0; shift < 32 && (maxOffset >> shift) > 0; shift += RADIX_BITS) {
+            int buckets[RADIX_BUCKETS] = {0};
+
+            for (int i = 0; i < list->count; i++) {
+                buckets[((source[i] - firstKey) >> shift) & (RADIX_BUCKETS - 1)]++;
+            }
+
+            for (int bucket = 0, total = 0; bucket < RADIX_BUCKETS; bucket++) {
+                int bucketSize = buckets[bucket];
+
+                buckets[bucket] = total;
+                total += bucketSize;
+            }
+
+            for (int i = 0; i < list->count; i++) {
+                destination[buckets[((source[i] - firstKey) >> shift) & (RADIX_BUCKETS - 1)]++] = source[i];
+            }
+
+            int *temp = source;
+            source = destination;
+            destination = temp;
+        }
+
+        if (source != list->keys) {
+            //The sorted keys ended up in the buffer, trade the storage with it instead of copying them back
+            int capacity = list->capacity;
+
+            list->keys = source;
+            list->capacity = sortBuffer->capacity;
+
+            sortBuffer->keys = destination;
+            sortBuffer->capacity = capacity;
+        }
+    }
+
+    int unique = 0;
+
+    for (int i = 0; i < list->count; i++) {
+        if (unique == 0 || list->keys[unique - 1] != list->keys[i]) {
+            list->keys[unique++] = list->keys[i];
+        }
+    }
+
+    list->count = unique;
+}
+
+//The position of the first key in the list that's not smaller than key
+static int lowerBound(EntityList *list, int key) {
+    int bottom = 0, top = list->count;
+
+    while (bottom < top) {
+        int middle = (bottom + top) / 2;
+
+        if (list->keys[middle] < key) {
+            bottom = middle + 1;
+        } else {
+            top = middle;
+        }
+    }
+
+    return bottom;
+}
+
+void initEntityCursor(EntityCursor *cursor, EntityList *lists, int listCount, int columns, int startRow, int endRow) {
+    cursor->lists = lists;
+    cursor->listCount = listCount;
+    cursor->columns = columns;
+
+    cursor->startKey = startRow * columns;
+    cursor->endKey = (endRow + 1) * columns;
+
+    cursor->row = startRow;
+    cursor->rowKey = cursor->startKey;
+
+    cursor->list = 0;
+    cursor->position = lowerBound(&lists[0], cursor->startKey);
+}
+
+int nextEntity(EntityCursor *cursor) {
+
+    while (cursor->list < cursor->listCount) {
+        EntityList *list = &cursor->lists[cursor->list];
+
+        if (cursor->position < list->count && list->keys[cursor->position] < cursor->endKey) {
+            int key = list->keys[cursor->position++];
+
+            while (key >= cursor->rowKey + cursor->columns) {
+                cursor->row++;
+                cursor->rowKey += cursor->columns;
+            }
+
+            return key;
+        }
+
+        //The partitions are in row order, so the rest of our rows can only be in the lists after this one
+        if (++cursor->list < cursor->listCount) {
+            cursor->position = lowerBound(&cursor->lists[cursor->list], cursor->startKey);
+        }
+    }
+
+    return -1;
+}
+
+void freeEntityIndex(EntityIndex *index) {
+    for (int parity = 0; parity < 2; parity++) {
+        for (int partition = 0; partition < index->partitions; partition++) {
+            free(index->worldEntities[parity][partition].keys);
+            free(index->nextWorldEntities[parity][partition].keys);
+        }
+
+        free(index->worldEntities[parity]);
+        free(index->nextWorldEntities[parity]);
+    }
+
+    for (int partition = 0; partition < index->partitions; partition++) {
+        free(index->sortBuffers[partition].keys);
+    }
+
+    free(index->sortBuffers);
+    free(index);
+}
@@ -0,0 +1,101 @@
+#ifndef TRABALHO_2_ENTITY_INDEX_H
+#define TRABALHO_2_ENTITY_INDEX_H
+
+#include <stddef.h>
+
+/**
+ * The slots of a range of rows that may hold an entity, stored as row major keys (row * columns + column).
+ *
+ * Once sorted, the keys are in the same order as a row major scan of the rows.
+ * Slots can be emptied after being added (A rabbit that is eaten, a fox that starves...),
+ * so the content of the slot must always be checked.
+ */
+#define ENTITY_KEY(columns, row, column) (((row) * (columns)) + (column))
+
+typedef struct EntityList_ {
+
+    int startRow, endRow;
+
+    int count, capacity;
+
+    int *keys;
+
+} EntityList;
+
+/**
+ * The index of where the entities are in both buffers of the world, so the generations
+ * only visit the slots that have entities instead of every slot
+ *
+ * Each partition (thread) writes its own lists, for the rows it had in that generation.
+ * The lists are kept for the generation after, as they are read by whichever partitions own those rows then.
+ */
+typedef struct EntityIndex_ {
+
+    int partitions;
+
+    //Indexed by the parity of the generation that wrote them and then by partition
+
+    //The entities in the world at the end of the generation
+    EntityList *worldEntities[2];
+
+    //The entities in the next world after the rabbits have moved
+    EntityList *nextWorldEntities[2];
+
+    //Scratch space for sorting the lists of each partition
+    EntityList *sortBuffers;
+
+} EntityIndex;
+
+/**
+ * Goes through the keys of a range of rows, across the lists of every partition
+ */
+typedef struct EntityCursor_ {
+
+    EntityList *lists;
+
+    int listCount, list, position;
+
+    int columns, startKey, endKey;
+
+    //The row of the last key returned, and the key of the first column of that row
+    int row, rowKey;
+
+} EntityCursor;
+
+EntityIndex *initEntityIndex(int partitions, int initialCapacity);
+
+void clearEntityList(EntityList *list, int startRow, int endRow);
+
+void growEntityList(EntityList *list);
+
+/**
+ * Add the key to the list (Nothing is done without a list, when the engine doesn't keep the index)
+ */
+static inline void appendEntity(EntityList *list, int key) {
+    if (list == NULL) return;
+
+    if (list->count == list->capacity) {
+        growEntityList(list);
+    }
+
+    list->keys[list->count++] = key;
+}
+
+/**
+ * Sort the keys of the list and remove the duplicates
+ * @param list
+ * @param sortBuffer
+ * @param columns
+ */
+void sortEntityList(EntityList *list, EntityList *sortBuffer, int columns);
+
+void initEntityCursor(EntityCursor *cursor, EntityList *lists, int listCount, int columns, int startRow, int endRow);
+
+/**
+ * @return The next key in the rows of the cursor, -1 when there are no more
+ */
+int nextEntity(EntityCursor *cursor);
+
+void freeEntityIndex(EntityIndex *index);
+
+#endif //TRABALHO_2_ENTITY_INDEX_H
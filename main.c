@@ -1,11 +1,36 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "rabbitsandfoxes.h"
+#include "benchmarks.h"
+#include "ensemble.h"
 
 int main(int argc, char **argv) {
 
     int sequential = 0, threads = 1;
 
+    Engine engine = SLOT_ENGINE;
+
+    //./ecosystem bench <name> runs a microbenchmark on the world of the input instead of the simulation
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        const char *name = argc > 2 ? argv[2] : "neighbours";
+
+        if (!runBenchmark(name, stdin, stdout)) {
+            fprintf(stderr, "Unknown benchmark %s\n", name);
+
+            return 1;
+        }
+
+        return 0;
+    }
+
+    //./ecosystem ensemble runs every world of the input (One after the other) as a single ensemble
+    if (argc > 1 && strcmp(argv[1], "ensemble") == 0) {
+        executeEnsemble(stdin, stdout);
+
+        return 0;
+    }
+
     if (argc > 1) {
         threads = atoi(argv[1]);
 
@@ -14,10 +39,25 @@ int main(int argc, char **argv) {
         }
     }
 
+    //The engine is chosen with a second argument, the slot engine is the default
+    if (argc > 2 && strcmp(argv[2], "bitboard") == 0) {
+        engine = BITBOARD_ENGINE;
+    } else if (argc > 2 && strcmp(argv[2], "gather") == 0) {
+        engine = GATHER_ENGINE;
+    } else if (argc > 2 && strcmp(argv[2], "fused") == 0) {
+        engine = FUSED_ENGINE;
+    } else if (argc > 2 && strcmp(argv[2], "atomic") == 0) {
+        engine = ATOMIC_ENGINE;
+    } else if (argc > 2 && strcmp(argv[2], "tiled") == 0) {
+        engine = TILED_ENGINE;
+    } else if (argc > 2 && strcmp(argv[2], "stealing") == 0) {
+        engine = STEALING_ENGINE;
+    }
+
     if (!sequential) {
-        executeWithThreadCount(threads, stdin, stdout);
+        executeWithThreadCount(threads, engine, stdin, stdout);
     } else {
-        executeSequentialThread(stdin, stdout);
+        executeSequentialThread(engine, stdin, stdout);
     }
 
     return 0;
@@ -1,17 +1,149 @@
 #include "matrix_utils.h"
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 
-void *initMatrix(int rows, int columns, unsigned int sizePerElement) {
+//Written before every allocation, so we know how to release it and what backs it
+typedef struct PageHeader_ {
+
+    size_t mappedSize;
+
+    PageBacking backing;
+
+} PageHeader;
+
+//Keep the data cache line aligned after the header
+#define PAGE_HEADER_SIZE 64
+
+#define ROUND_UP(size, alignment) (((size) + (alignment) - 1) & ~((size_t) (alignment) - 1))
+
+static const char *BACKING_NAMES[] = {
+        [HEAP_BACKING] = "heap",
+        [SMALL_PAGE_BACKING] = "4 KB pages",
+        [TRANSPARENT_HUGE_PAGE_BACKING] = "transparent huge pages",
+        [HUGETLB_BACKING] = "hugetlb 2 MB pages",
+};
+
+#ifdef HUGE_PAGE_MATRIX
+
+/*
+ * madvise(MADV_HUGEPAGE) succeeds even when transparent huge pages are turned off,
+ * so check the system setting to know if we are really getting them
+ */
+static int transparentHugePagesEnabled() {
+    FILE *file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+
+    if (file == NULL) return 0;
+
+    char setting[128] = {0};
+
+    if (fgets(setting, sizeof(setting), file) == NULL) setting[0] = '\0';
+
+    fclose(file);
+
+    return strstr(setting, "[never]") == NULL && setting[0] != '\0';
+}
+
+static void *mapPages(size_t size, PageBacking *backing) {
+
+    //Reserved huge pages first (Only available if the administrator set up vm.nr_hugepages)
+    void *pages = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+    if (pages != MAP_FAILED) {
+        *backing = HUGETLB_BACKING;
+
+        return pages;
+    }
+
+    //Transparent huge pages can only back ranges that are aligned to the huge page size,
+    //so map a huge page more than we need and trim it to the first aligned address
+    size_t mappedSize = size + HUGE_PAGE_SIZE;
+
+    char *mapped = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (mapped == MAP_FAILED) return NULL;
+
+    char *aligned = (char *) ROUND_UP((size_t) mapped, HUGE_PAGE_SIZE);
+
+    if (aligned != mapped) munmap(mapped, aligned - mapped);
+
+    if (aligned + size != mapped + mappedSize) munmap(aligned + size, (mapped + mappedSize) - (aligned + size));
 
-    //Allocate with calloc to make sure that all positions are initialized at 0
-    void *matrix = calloc(rows * columns, sizePerElement);
+    if (madvise(aligned, size, MADV_HUGEPAGE) == 0 && transparentHugePagesEnabled()) {
+        *backing = TRANSPARENT_HUGE_PAGE_BACKING;
+    } else {
+        *backing = SMALL_PAGE_BACKING;
+    }
 
-    return matrix;
+    return aligned;
+}
+
+#endif
+
+void *allocPages(size_t size) {
+
+    size_t totalSize = size + PAGE_HEADER_SIZE;
+
+    PageHeader *header = NULL;
+
+#ifdef HUGE_PAGE_MATRIX
+    //Anything smaller than a huge page would only waste the rest of it
+    if (totalSize >= HUGE_PAGE_SIZE) {
+        PageBacking backing;
+
+        size_t mappedSize = ROUND_UP(totalSize, HUGE_PAGE_SIZE);
+
+        //Anonymous mappings are already zeroed
+        header = mapPages(mappedSize, &backing);
+
+        if (header != NULL) {
+            header->mappedSize = mappedSize;
+            header->backing = backing;
+        }
+    }
+#endif
+
+    if (header == NULL) {
+        //Allocate with calloc to make sure that all positions are initialized at 0
+        header = calloc(1, totalSize);
+
+        if (header == NULL) return NULL;
+
+        header->mappedSize = 0;
+        header->backing = HEAP_BACKING;
+    }
+
+    return ((char *) header) + PAGE_HEADER_SIZE;
+}
+
+PageBacking getPageBacking(void *pages) {
+    return ((PageHeader *) (((char *) pages) - PAGE_HEADER_SIZE))->backing;
+}
+
+const char *getPageBackingName(PageBacking backing) {
+    return BACKING_NAMES[backing];
+}
+
+void freePages(void *pages) {
+    if (pages == NULL) return;
+
+    PageHeader *header = (PageHeader *) (((char *) pages) - PAGE_HEADER_SIZE);
+
+    if (header->backing == HEAP_BACKING) {
+        free(header);
+    } else {
+        munmap(header, header->mappedSize);
+    }
+}
+
+void *initMatrix(int rows, int columns, unsigned int sizePerElement) {
+    return allocPages(MATRIX_SLOTS(rows, columns) * sizePerElement);
 }
 
 void freeMatrix(void **matrix) {
-    free(*matrix);
+    freePages(*matrix);
 
     *matrix = NULL;
-}
\ No newline at end of file
+}
@@ -1,7 +1,87 @@
 #ifndef TRABALHO_2_MATRIX_UTILS_H
 #define TRABALHO_2_MATRIX_UTILS_H
 
-#define PROJECT(columns, row, column) (((row) * (columns)) + (column))
+#include <stddef.h>
+
+#ifdef FIXED_COLUMNS
+
+/*
+ * Width specialized build: every matrix has FIXED_COLUMNS columns, so the stride of PROJECT is a constant
+ * everywhere it's used. The world that is read has to have that many columns (See readInputData)
+ */
+#define MATRIX_COLUMNS(columns) (FIXED_COLUMNS)
+
+#define STRINGIFY_VALUE(value) #value
+#define STRINGIFY(value) STRINGIFY_VALUE(value)
+
+#define MATRIX_WIDTH ", " STRINGIFY(FIXED_COLUMNS) " fixed columns"
+
+#else
+
+#define MATRIX_COLUMNS(columns) (columns)
+
+#define MATRIX_WIDTH ""
+
+#endif
+
+#ifdef TILED_MATRIX
+
+/*
+ * Tiled layout: the matrix is stored as TILE_SIZE x TILE_SIZE tiles (Row major inside each tile, and the tiles
+ * row major between them), so the slots above and below a slot are TILE_SIZE elements away instead of a whole row.
+ * The matrix is padded to a whole number of tiles.
+ */
+#define TILE_SHIFT 6
+#define TILE_SIZE (1 << TILE_SHIFT)
+#define TILE_MASK (TILE_SIZE - 1)
+
+#define TILES_FOR(length) (((length) + TILE_MASK) >> TILE_SHIFT)
+
+#define PROJECT(columns, row, column) \
+    (((((row) >> TILE_SHIFT) * TILES_FOR(MATRIX_COLUMNS(columns)) + ((column) >> TILE_SHIFT)) << (2 * TILE_SHIFT)) \
+    | (((row) & TILE_MASK) << TILE_SHIFT) | ((column) & TILE_MASK))
+
+#define MATRIX_SLOTS(rows, columns) (((size_t) TILES_FOR(rows) * TILES_FOR(columns)) << (2 * TILE_SHIFT))
+
+#define MATRIX_LAYOUT "tiled 64x64" MATRIX_WIDTH
+
+#else
+
+#define PROJECT(columns, row, column) (((row) * MATRIX_COLUMNS(columns)) + (column))
+
+#define MATRIX_SLOTS(rows, columns) ((size_t) (rows) * (columns))
+
+#define MATRIX_LAYOUT "row major" MATRIX_WIDTH
+
+#endif
+
+#define HUGE_PAGE_SIZE ((size_t) 2 << 20)
+
+/**
+ * What ended up backing an allocation made with allocPages
+ *
+ * With HUGE_PAGE_MATRIX, allocations of at least a huge page try MAP_HUGETLB, then madvise(MADV_HUGEPAGE),
+ * and fall back to regular pages when neither is available. Everything else comes from the heap.
+ */
+typedef enum PageBacking_ {
+
+    HEAP_BACKING = 0,
+    SMALL_PAGE_BACKING = 1,
+    TRANSPARENT_HUGE_PAGE_BACKING = 2,
+    HUGETLB_BACKING = 3
+
+} PageBacking;
+
+/**
+ * Allocate size zeroed bytes, backed by huge pages when possible. Must be released with freePages
+ */
+void *allocPages(size_t size);
+
+PageBacking getPageBacking(void *pages);
+
+const char *getPageBackingName(PageBacking backing);
+
+void freePages(void *pages);
 
 void* initMatrix(int rows, int cols, unsigned int sizePerElement);
 
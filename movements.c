@@ -1,261 +1,174 @@
 
 #include "movements.h"
 #include "matrix_utils.h"
-#include <stdlib.h>
 
-#define DIRECTIONS 4
-
-static Move *NORTH_MOVE = NULL;
-static Move *EAST_MOVE = NULL;
-static Move *SOUTH_MOVE = NULL;
-static Move *WEST_MOVE = NULL;
-
-static MoveDirection *defaultDirections = NULL;
-
-static void initMoves() {
-
-    NORTH_MOVE = malloc(sizeof(Move));
-
-    NORTH_MOVE->x = -1;
-    NORTH_MOVE->y = 0;
-
-    EAST_MOVE = malloc(sizeof(Move));
-
-    EAST_MOVE->x = 0;
-    EAST_MOVE->y = 1;
-
-    SOUTH_MOVE = malloc(sizeof(Move));
-    SOUTH_MOVE->x = 1;
-    SOUTH_MOVE->y = 0;
-
-    WEST_MOVE = malloc(sizeof(Move));
-    WEST_MOVE->x = 0;
-    WEST_MOVE->y = -1;
-
-}
-
-static void initDefaultDirections() {
-    defaultDirections = malloc(sizeof(MoveDirection) * DIRECTIONS);
-
-    defaultDirections[0] = 0;
-    defaultDirections[1] = 1;
-    defaultDirections[2] = 2;
-    defaultDirections[3] = 3;
-}
-
-Move *getMoveFor(MoveDirection direction) {
-
-    if (NORTH_MOVE == NULL || EAST_MOVE == NULL || SOUTH_MOVE == NULL || WEST_MOVE == NULL) {
-
-        initMoves();
-
-    }
-
-    switch (direction) {
-        case NORTH: {
-            return NORTH_MOVE;
+const Move DIRECTION_MOVES[DIRECTIONS] = {
+        [NORTH] = {-1, 0},
+        [EAST] = {0, 1},
+        [SOUTH] = {1, 0},
+        [WEST] = {0, -1}
+};
+
+const uint8_t MASK_MOVE_COUNT[MOVE_MASKS] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+
+const MoveDirection MASK_DIRECTIONS[MOVE_MASKS][DIRECTIONS] = {
+        {0},
+        {NORTH},
+        {EAST},
+        {NORTH, EAST},
+        {SOUTH},
+        {NORTH, SOUTH},
+        {EAST, SOUTH},
+        {NORTH, EAST, SOUTH},
+        {WEST},
+        {NORTH, WEST},
+        {EAST, WEST},
+        {NORTH, EAST, WEST},
+        {SOUTH, WEST},
+        {NORTH, SOUTH, WEST},
+        {EAST, SOUTH, WEST},
+        {NORTH, EAST, SOUTH, WEST}
+};
+
+const uint8_t MOVE_CHOICE[MOVE_CYCLE][DIRECTIONS + 1] = {
+        {0, 0, 0, 0, 0},
+        {0, 0, 1, 1, 1},
+        {0, 0, 0, 2, 2},
+        {0, 0, 1, 0, 3},
+        {0, 0, 0, 1, 0},
+        {0, 0, 1, 2, 1},
+        {0, 0, 0, 0, 2},
+        {0, 0, 1, 1, 3},
+        {0, 0, 0, 2, 0},
+        {0, 0, 1, 0, 1},
+        {0, 0, 0, 1, 2},
+        {0, 0, 1, 2, 3}
+};
+
+uint8_t getDefaultMoveMask(int row, int col, InputData *inputData, World *world) {
+
+    uint8_t moves = 0;
+
+    for (int direction = 0; direction < DIRECTIONS; direction++) {
+        int finalRow = row + DIRECTION_MOVES[direction].x, finalCol = col + DIRECTION_MOVES[direction].y;
+
+        if (finalRow < 0 || finalCol < 0 || finalRow >= inputData->rows || finalCol >= inputData->columns) {
+            continue;
         }
-        case EAST: {
-            return EAST_MOVE;
-        }
-        case SOUTH: {
-            return SOUTH_MOVE;
-        }
-        case WEST: {
-            return WEST_MOVE;
-        }
-
-        default:
-            return NORTH_MOVE;
-    }
-
-}
-
-struct DefaultMovements getDefaultPossibleMovements(int x, int y, InputData *inputData, WorldSlot *world) {
-
-    int possibleMoves[4] = {1, 1, 1, 1};
-
-    int defaultP = 0;
-
-    for (int i = 0; i < 4; i++) {
-        if (possibleMoves[i]) {
-            Move *move = getMoveFor(i);
-
-            int finalX = x + move->x, finalY = y + move->y;
 
-            if (finalX < 0 || finalY < 0 || finalX >= inputData->columns || finalY >= inputData->rows) {
-                possibleMoves[i] = 0;
-                continue;
-            }
-
-            WorldSlot *slot = &world[PROJECT(inputData->columns,
-                                             x + move->x, y + move->y)];
-
-            if (slot->slotContent == ROCK) {
-                //If there's a rock, this move will never be possible, as rocks are never removed
-                possibleMoves[i] = 0;
-            }
+        if (world->slotContent[PROJECT(inputData->columns, finalRow, finalCol)] == ROCK) {
+            //If there's a rock, this move will never be possible, as rocks are never removed
+            continue;
         }
 
-        defaultP += possibleMoves[i];
+        moves |= 1 << direction;
     }
 
-    MoveDirection *directions;
+    return moves;
+}
 
-    if (defaultP < 4) {
-        directions = malloc(sizeof(MoveDirection) * defaultP);
+//The rabbits and the empty slots among the moves of the mask of the slot at (row, col)
+static inline void getNeighbourMoveMasks(int row, int col, int moves, InputData *inputData, World *world,
+                                         int *rabbitMask, int *emptyMask) {
+    int rabbits = 0, empty = 0;
 
-        int current = 0;
+    for (int i = 0; i < MASK_MOVE_COUNT[moves]; i++) {
+        MoveDirection direction = MASK_DIRECTIONS[moves][i];
 
-        for (int i = 0; i < 4; i++) {
-            if (possibleMoves[i]) {
-                directions[current++] = i;
-            }
-        }
-    } else {
-        //If we can move in every direction, we can use the default global array to save memory
-        if (defaultDirections == NULL) {
-            initDefaultDirections();
-        }
+        uint8_t possibleSlot = world->slotContent[PROJECT(inputData->columns, row + DIRECTION_MOVES[direction].x,
+                                                          col + DIRECTION_MOVES[direction].y)];
 
-        directions = defaultDirections;
+        rabbits |= (possibleSlot == RABBIT) << direction;
+        empty |= (possibleSlot == EMPTY) << direction;
     }
 
-    struct DefaultMovements movements = {defaultP, directions};
-
-    return movements;
+    *rabbitMask = rabbits;
+    *emptyMask = empty;
 }
 
-struct FoxMovements *initFoxMovements() {
-    struct FoxMovements *foxMovements = malloc(sizeof(struct FoxMovements));
-
-    foxMovements->emptyMovements = 0;
-    foxMovements->rabbitMovements = 0;
-    foxMovements->rabbitDirections = malloc(sizeof(MoveDirection) * DIRECTIONS);
-    foxMovements->emptyDirections = malloc(sizeof(MoveDirection) * DIRECTIONS);
-
-    return foxMovements;
-}
+void getPossibleFoxMovements(int x, int y, InputData *inputData, World *world, struct FoxMovements *dest) {
 
-struct RabbitMovements *initRabbitMovements() {
-    struct RabbitMovements *rabbitMovements = malloc(sizeof(struct RabbitMovements));
+    int rabbitMask, emptyMask;
 
-    rabbitMovements->emptyMovements = 0;
-    rabbitMovements->emptyDirections = malloc(sizeof(MoveDirection) * DIRECTIONS);
+    getNeighbourMoveMasks(x, y, world->topology->defaultMoves[PROJECT(inputData->columns, x, y)], inputData, world,
+                          &rabbitMask, &emptyMask);
 
-    return rabbitMovements;
+    getFoxMovementsFromMasks(rabbitMask, emptyMask, dest);
 }
 
-void getPossibleFoxMovements(int x, int y, InputData *inputData, WorldSlot *world, struct FoxMovements *dest) {
-
-    WorldSlot currentSlot = world[PROJECT(inputData->columns, x, y)];
-
-    int rabbitMovements = 0, emptyMovements = 0;
-
-    int rabbitMoves[currentSlot.defaultP], emptyMoves[currentSlot.defaultP];
-
-    for (int i = 0; i < currentSlot.defaultP; i++) {
-        MoveDirection direction = currentSlot.defaultPossibleMoveDirections[i];
+void getPossibleRabbitMovements(int x, int y, InputData *inputData, World *world,
+                                struct RabbitMovements *rabbitMovements) {
 
-        Move *move = getMoveFor(direction);
+    int rabbitMask, emptyMask;
 
-        WorldSlot *possibleSlot = &world[PROJECT(inputData->columns, x + move->x, y + move->y)];
+    getNeighbourMoveMasks(x, y, world->topology->defaultMoves[PROJECT(inputData->columns, x, y)], inputData, world,
+                          &rabbitMask, &emptyMask);
 
-        if (possibleSlot->slotContent == RABBIT) {
-            rabbitMovements++;
+    getRabbitMovementsFromMask(emptyMask, rabbitMovements);
+}
 
-            rabbitMoves[i] = 1;
-            emptyMoves[i] = 0;
-        } else if (possibleSlot->slotContent == EMPTY) {
-            emptyMovements++;
-            emptyMoves[i] = 1;
-            rabbitMoves[i] = 0;
-        } else {
-            emptyMoves[i] = 0;
-            rabbitMoves[i] = 0;
-        }
+//The words of the plane with a bit for each slot that exists (Or for each slot that is not in the plane, if empty)
+static inline uint64_t planeWord(World *world, uint64_t *plane, int empty, int row, int word) {
+    if (row < 0 || row >= world->rows || word < 0 || word >= world->occupiedWordsPerRow) {
+        return 0;
     }
 
-    dest->rabbitMovements = rabbitMovements;
-    dest->emptyMovements = emptyMovements;
+    uint64_t bits = plane[row * world->occupiedWordsPerRow + word];
 
-    if (rabbitMovements > 0) {
-        int current = 0;
+    if (!empty) return bits;
 
-        for (int i = 0; i < currentSlot.defaultP; i++) {
-            if (rabbitMoves[i]) {
-                dest->rabbitDirections[current++] = currentSlot.defaultPossibleMoveDirections[i];
-            }
-        }
-
-    } else if (emptyMovements > 0) {
-        int current = 0;
+    bits = ~bits;
 
-        for (int i = 0; i < currentSlot.defaultP; i++) {
-            if (emptyMoves[i]) {
-                dest->emptyDirections[current++] = currentSlot.defaultPossibleMoveDirections[i];
-            }
-        }
+    //The padding at the end of the last word of the row is not part of the world
+    if (word == world->occupiedWordsPerRow - 1 && (world->columns & 63) != 0) {
+        bits &= (1ULL << (world->columns & 63)) - 1;
     }
 
+    return bits;
 }
 
-void getPossibleRabbitMovements(int x, int y, InputData *inputData, WorldSlot *world,
-                                struct RabbitMovements *rabbitMovements) {
-
-    WorldSlot *currentSlot = &world[PROJECT(inputData->columns, x, y)];
-
-    int emptyMovements = 0;
+void getNeighbourMasks(World *world, uint64_t *plane, int empty, int row, int word, struct NeighbourMasks *dest) {
 
-    int emptyMoves[currentSlot->defaultP];
+    int wordsPerRow = world->occupiedWordsPerRow;
 
-    for (int i = 0; i < currentSlot->defaultP; i++) {
-        MoveDirection direction = currentSlot->defaultPossibleMoveDirections[i];
+    if (row > 0 && row < world->rows - 1 && word > 0 && word < wordsPerRow - 1) {
+        //A word away from the edges of the world: its neighbouring words all exist and have no padding
+        uint64_t *words = &plane[row * wordsPerRow + word], flip = empty ? ~0ULL : 0;
 
-        Move *move = getMoveFor(direction);
+        uint64_t interior = words[0] ^ flip;
 
-        WorldSlot *possibleSlot = &world[PROJECT(inputData->columns, x + move->x, y + move->y)];
+        dest->directions[NORTH] = words[-wordsPerRow] ^ flip;
+        dest->directions[SOUTH] = words[wordsPerRow] ^ flip;
+        dest->directions[EAST] = (interior >> 1) | ((words[1] ^ flip) << 63);
+        dest->directions[WEST] = (interior << 1) | ((words[-1] ^ flip) >> 63);
 
-        if (possibleSlot->slotContent == EMPTY) {
-            emptyMovements++;
-            emptyMoves[i] = 1;
-        } else {
-            emptyMoves[i] = 0;
-        }
+        return;
     }
 
-    rabbitMovements->emptyMovements = emptyMovements;
+    uint64_t current = planeWord(world, plane, empty, row, word);
 
-    if (emptyMovements > 0) {
-        int current = 0;
+    dest->directions[NORTH] = planeWord(world, plane, empty, row - 1, word);
+    dest->directions[SOUTH] = planeWord(world, plane, empty, row + 1, word);
 
-        for (int i = 0; i < currentSlot->defaultP; i++) {
-            if (emptyMoves[i]) {
-                rabbitMovements->emptyDirections[current++] = currentSlot->defaultPossibleMoveDirections[i];
-            }
-        }
-    }
+    //The neighbour to the east of a slot is the next bit, the first bit of the next word for the last slot
+    dest->directions[EAST] = (current >> 1) | (planeWord(world, plane, empty, row, word + 1) << 63);
+    dest->directions[WEST] = (current << 1) | (planeWord(world, plane, empty, row, word - 1) >> 63);
 }
 
-void freeMovementForSlot(MoveDirection *directions) {
-    if (directions != defaultDirections) {
-        free(directions);
-    }
-}
+void getRabbitMovementsFromMask(int emptyMask, struct RabbitMovements *dest) {
+    dest->emptyMovements = MASK_MOVE_COUNT[emptyMask];
 
-void freeDefaultMovements(struct DefaultMovements *movements) {
-    free(movements->directions);
+    for (int i = 0; i < DIRECTIONS; i++) {
+        dest->emptyDirections[i] = MASK_DIRECTIONS[emptyMask][i];
+    }
 }
 
-void freeFoxMovements(struct FoxMovements *foxMovements) {
-    free(foxMovements->rabbitDirections);
-    free(foxMovements->emptyDirections);
+void getFoxMovementsFromMasks(int rabbitMask, int emptyMask, struct FoxMovements *dest) {
+    dest->rabbitMovements = MASK_MOVE_COUNT[rabbitMask];
+    dest->emptyMovements = MASK_MOVE_COUNT[emptyMask];
 
-    free(foxMovements);
+    for (int i = 0; i < DIRECTIONS; i++) {
+        dest->rabbitDirections[i] = MASK_DIRECTIONS[rabbitMask][i];
+        dest->emptyDirections[i] = MASK_DIRECTIONS[emptyMask][i];
+    }
 }
-
-void freeRabbitMovements(struct RabbitMovements *rabbitMovements) {
-    free(rabbitMovements->emptyDirections);
-
-    free(rabbitMovements);
-}
\ No newline at end of file
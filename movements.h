@@ -10,25 +10,81 @@ typedef enum MoveDirection_ {
     WEST = 3
 } MoveDirection;
 
+#define DIRECTIONS 4
+
+/**
+ * The change in row (x) and column (y) of a move
+ */
 typedef struct Move_ {
     int x, y;
 } Move;
 
-struct DefaultMovements {
-    int movementCount;
+/**
+ * The move in each direction
+ */
+extern const Move DIRECTION_MOVES[DIRECTIONS];
 
-    MoveDirection *directions;
-};
+/*
+ * A move mask has bit i set when the move in direction i is possible, so there are only 16 of them.
+ * For each mask: how many moves it has, and their directions in order
+ */
+#define MOVE_MASKS (1 << DIRECTIONS)
+
+#define ALL_MOVES (MOVE_MASKS - 1)
+
+extern const uint8_t MASK_MOVE_COUNT[MOVE_MASKS];
+
+extern const MoveDirection MASK_DIRECTIONS[MOVE_MASKS][DIRECTIONS];
+
+/*
+ * The move an animal makes out of count possible ones is (genNumber + row + col) % count. Every count divides
+ * MOVE_CYCLE, so the choice can be looked up with a modulo by a constant instead of a division by count
+ */
+#define MOVE_CYCLE 12
+
+extern const uint8_t MOVE_CHOICE[MOVE_CYCLE][DIRECTIONS + 1];
+
+static inline int chooseMove(int genNumber, int row, int col, int count) {
+    return MOVE_CHOICE[(unsigned int) (genNumber + row + col) % MOVE_CYCLE][count];
+}
 
+/**
+ * If the animal that is moving survives ending up in the same slot as inSlot, an animal of the same species.
+ *
+ * The oldest one survives, counting the age the one that has not been updated in genNumber yet will have after it is.
+ * With byFood, a tie goes to the fox that has eaten the latest. Otherwise (Or if they have also eaten at the same time)
+ * the one that was moving dies.
+ *
+ * Both are packed into a single key, so picking the survivor is a single comparison instead of nested branches
+ */
+static inline int survivesCollision(int genNumber, EntityInfo *moving, EntityInfo *inSlot, const int byFood) {
+    int movingUpdated = moving->genUpdated == (genNumber & 1), slotUpdated = inSlot->genUpdated == (genNumber & 1);
+
+    uint64_t movingAge = moving->currentGenProc + (uint64_t) ((!movingUpdated) & slotUpdated),
+            slotAge = inSlot->currentGenProc + (uint64_t) (movingUpdated & (!slotUpdated));
+
+    //Less food means it has eaten later
+    uint64_t foodMask = byFood ? UINT16_MAX : 0;
+
+    uint64_t movingKey = (movingAge << 16) | ((uint16_t) ~moving->currentGenFood & foodMask),
+            slotKey = (slotAge << 16) | ((uint16_t) ~inSlot->currentGenFood & foodMask);
+
+    return movingKey > slotKey;
+}
+
+/*
+ * The movement structs are small enough to live on the stack of the generation that uses them,
+ * so the generation loop never has to allocate them
+ */
 struct FoxMovements {
     //Movements that lead to a rabbit
     int rabbitMovements;
 
-    MoveDirection *rabbitDirections;
+    MoveDirection rabbitDirections[DIRECTIONS];
 
     int emptyMovements;
 
-    MoveDirection *emptyDirections;
+    MoveDirection emptyDirections[DIRECTIONS];
 
 };
 
@@ -36,28 +92,47 @@ struct RabbitMovements {
 
     int emptyMovements;
 
-    MoveDirection *emptyDirections;
+    MoveDirection emptyDirections[DIRECTIONS];
 
 };
 
-Move *getMoveFor(MoveDirection direction);
-
-struct DefaultMovements getDefaultPossibleMovements(int x, int y, InputData *inputData, WorldSlot *world);
-
-struct FoxMovements *initFoxMovements();
+/**
+ * For 64 slots of a row at a time: a word per direction, with the bit of each slot set
+ * when its neighbour in that direction is in the plane
+ */
+struct NeighbourMasks {
+    uint64_t directions[DIRECTIONS];
+};
 
-struct RabbitMovements *initRabbitMovements();
+/**
+ * The move mask of the slot at bit of the word the masks were calculated for,
+ * with bit i set when the move in direction i is possible
+ */
+static inline int getMoveMask(struct NeighbourMasks *masks, int bit) {
+    return (int) (((masks->directions[NORTH] >> bit) & 1)
+                  | (((masks->directions[EAST] >> bit) & 1) << 1)
+                  | (((masks->directions[SOUTH] >> bit) & 1) << 2)
+                  | (((masks->directions[WEST] >> bit) & 1) << 3));
+}
 
-void getPossibleFoxMovements(int x, int y, InputData *inputData, WorldSlot *world, struct FoxMovements *dest);
+/**
+ * The move mask of the moves that can ever be made from the slot: the ones that stay inside the world and don't
+ * lead to a rock (Rocks are never removed)
+ */
+uint8_t getDefaultMoveMask(int row, int col, InputData *inputData, World *world);
 
-void getPossibleRabbitMovements(int x, int y, InputData *inputData, WorldSlot *world, struct RabbitMovements *dest);
+void getPossibleFoxMovements(int x, int y, InputData *inputData, World *world, struct FoxMovements *dest);
 
-void freeMovementForSlot(MoveDirection *directions);
+void getPossibleRabbitMovements(int x, int y, InputData *inputData, World *world, struct RabbitMovements *dest);
 
-void freeDefaultMovements(struct DefaultMovements *movements);
+/**
+ * Calculate the neighbours in the plane of the slots of a word of a row of the world.
+ * With empty set, the neighbours that are not in the plane (And are inside the world) are used instead
+ */
+void getNeighbourMasks(World *world, uint64_t *plane, int empty, int row, int word, struct NeighbourMasks *dest);
 
-void freeFoxMovements(struct FoxMovements *foxMovements);
+void getRabbitMovementsFromMask(int emptyMask, struct RabbitMovements *dest);
 
-void freeRabbitMovements(struct RabbitMovements *rabbitMovements);
+void getFoxMovementsFromMasks(int rabbitMask, int emptyMask, struct FoxMovements *dest);
 
 #endif //TRABALHO_2_MOVEMENTS_H
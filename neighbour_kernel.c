@@ -0,0 +1,272 @@
+#include "neighbour_kernel.h"
+#include "matrix_utils.h"
+#include "movements.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#define X86_KERNELS
+
+#endif
+
+static inline void classifySlot(World *world, int row, int col, uint8_t *rabbitMask, uint8_t *emptyMask) {
+
+    int rabbits = 0, empty = 0;
+
+    for (int direction = 0; direction < DIRECTIONS; direction++) {
+        int neighbourRow = row + DIRECTION_MOVES[direction].x, neighbourCol = col + DIRECTION_MOVES[direction].y;
+
+        if (neighbourRow < 0 || neighbourCol < 0 || neighbourRow >= world->rows || neighbourCol >= world->columns) {
+            continue;
+        }
+
+        uint8_t content = world->slotContent[PROJECT(world->columns, neighbourRow, neighbourCol)];
+
+        rabbits |= (content == RABBIT) << direction;
+        empty |= (content == EMPTY) << direction;
+    }
+
+    *rabbitMask = (uint8_t) rabbits;
+    *emptyMask = (uint8_t) empty;
+}
+
+//Same as classifySlot, for a slot that is not on the edge of the world, so none of its neighbours has to be checked
+static inline void classifyInteriorSlot(World *world, int row, int col, uint8_t *rabbitMask, uint8_t *emptyMask) {
+
+    uint8_t neighbours[DIRECTIONS] = {
+            world->slotContent[PROJECT(world->columns, row - 1, col)],
+            world->slotContent[PROJECT(world->columns, row, col + 1)],
+            world->slotContent[PROJECT(world->columns, row + 1, col)],
+            world->slotContent[PROJECT(world->columns, row, col - 1)]
+    };
+
+    int rabbits = 0, empty = 0;
+
+    for (int direction = 0; direction < DIRECTIONS; direction++) {
+        rabbits |= (neighbours[direction] == RABBIT) << direction;
+        empty |= (neighbours[direction] == EMPTY) << direction;
+    }
+
+    *rabbitMask = (uint8_t) rabbits;
+    *emptyMask = (uint8_t) empty;
+}
+
+static void classifyScalar(World *world, int row, int startCol, uint8_t *rabbitMasks, uint8_t *emptyMasks) {
+
+    int count = world->columns - startCol < KERNEL_SEGMENT ? world->columns - startCol : KERNEL_SEGMENT;
+
+    //The slots of the segment that are not on the edge of the world
+    int interiorStart = 0, interiorEnd = 0;
+
+    if (row > 0 && row < world->rows - 1) {
+        interiorStart = startCol == 0 ? 1 : 0;
+        interiorEnd = startCol + count == world->columns ? count - 1 : count;
+    }
+
+    for (int slot = 0; slot < interiorStart; slot++) {
+        classifySlot(world, row, startCol + slot, &rabbitMasks[slot], &emptyMasks[slot]);
+    }
+
+    for (int slot = interiorStart; slot < interiorEnd; slot++) {
+        classifyInteriorSlot(world, row, startCol + slot, &rabbitMasks[slot], &emptyMasks[slot]);
+    }
+
+    for (int slot = interiorEnd > interiorStart ? interiorEnd : interiorStart; slot < count; slot++) {
+        classifySlot(world, row, startCol + slot, &rabbitMasks[slot], &emptyMasks[slot]);
+    }
+}
+
+/**
+ * If the whole segment is away from the edges of the world, so it can be classified without any bounds checks
+ */
+static inline int isInteriorSegment(World *world, int row, int startCol) {
+    return row > 0 && row < world->rows - 1 && startCol > 0 && startCol + KERNEL_SEGMENT < world->columns;
+}
+
+/*
+ * The vector kernels only handle whole segments. The slots inside the segment have their east and west neighbours
+ * in the same contiguous run, so only the first and last slot are classified on their own (Their neighbours can be
+ * in another tile).
+ *
+ * Each kernel is specialized for interior segments, which are most of the segments of a big world, and for the
+ * segments on the edges of the world, which check for the rows that don't exist.
+ */
+#ifdef X86_KERNELS
+
+__attribute__((target("sse2"), always_inline))
+static inline void classifySegmentSSE2(World *world, int row, int startCol, uint8_t *rabbitMasks,
+                                       uint8_t *emptyMasks, const int border) {
+
+    const uint8_t *current = &world->slotContent[PROJECT(world->columns, row, startCol)],
+            *north = border && row == 0 ? NULL : &world->slotContent[PROJECT(world->columns, row - 1, startCol)],
+            *south = border && row == world->rows - 1 ? NULL
+                                                       : &world->slotContent[PROJECT(world->columns, row + 1, startCol)];
+
+    const __m128i empty = _mm_set1_epi8(EMPTY), rabbit = _mm_set1_epi8(RABBIT), outside = _mm_set1_epi8(ROCK);
+
+    const __m128i bits[DIRECTIONS] = {_mm_set1_epi8(1 << NORTH), _mm_set1_epi8(1 << EAST),
+                                      _mm_set1_epi8(1 << SOUTH), _mm_set1_epi8(1 << WEST)};
+
+    for (int slot = 1; slot < KERNEL_SEGMENT - 1; slot += 16) {
+
+        //The last vector overlaps the one before it, so it doesn't read past the segment
+        if (slot > KERNEL_SEGMENT - 1 - 16) slot = KERNEL_SEGMENT - 1 - 16;
+
+        __m128i neighbours[DIRECTIONS] = {
+                !border || north != NULL ? _mm_loadu_si128((const __m128i *) (north + slot)) : outside,
+                _mm_loadu_si128((const __m128i *) (current + slot + 1)),
+                !border || south != NULL ? _mm_loadu_si128((const __m128i *) (south + slot)) : outside,
+                _mm_loadu_si128((const __m128i *) (current + slot - 1))
+        };
+
+        __m128i rabbits = _mm_setzero_si128(), empties = _mm_setzero_si128();
+
+        for (int direction = 0; direction < DIRECTIONS; direction++) {
+            rabbits = _mm_or_si128(rabbits, _mm_and_si128(_mm_cmpeq_epi8(neighbours[direction], rabbit),
+                                                          bits[direction]));
+            empties = _mm_or_si128(empties, _mm_and_si128(_mm_cmpeq_epi8(neighbours[direction], empty),
+                                                          bits[direction]));
+        }
+
+        _mm_storeu_si128((__m128i *) (rabbitMasks + slot), rabbits);
+        _mm_storeu_si128((__m128i *) (emptyMasks + slot), empties);
+    }
+
+    if (border) {
+        classifySlot(world, row, startCol, &rabbitMasks[0], &emptyMasks[0]);
+        classifySlot(world, row, startCol + KERNEL_SEGMENT - 1, &rabbitMasks[KERNEL_SEGMENT - 1],
+                     &emptyMasks[KERNEL_SEGMENT - 1]);
+    } else {
+        classifyInteriorSlot(world, row, startCol, &rabbitMasks[0], &emptyMasks[0]);
+        classifyInteriorSlot(world, row, startCol + KERNEL_SEGMENT - 1, &rabbitMasks[KERNEL_SEGMENT - 1],
+                             &emptyMasks[KERNEL_SEGMENT - 1]);
+    }
+}
+
+__attribute__((target("sse2")))
+static void classifySSE2(World *world, int row, int startCol, uint8_t *rabbitMasks, uint8_t *emptyMasks) {
+
+    if (world->columns - startCol < KERNEL_SEGMENT) {
+        classifyScalar(world, row, startCol, rabbitMasks, emptyMasks);
+    } else if (isInteriorSegment(world, row, startCol)) {
+        classifySegmentSSE2(world, row, startCol, rabbitMasks, emptyMasks, 0);
+    } else {
+        classifySegmentSSE2(world, row, startCol, rabbitMasks, emptyMasks, 1);
+    }
+}
+
+__attribute__((target("avx2"), always_inline))
+static inline void classifySegmentAVX2(World *world, int row, int startCol, uint8_t *rabbitMasks,
+                                       uint8_t *emptyMasks, const int border) {
+
+    const uint8_t *current = &world->slotContent[PROJECT(world->columns, row, startCol)],
+            *north = border && row == 0 ? NULL : &world->slotContent[PROJECT(world->columns, row - 1, startCol)],
+            *south = border && row == world->rows - 1 ? NULL
+                                                       : &world->slotContent[PROJECT(world->columns, row + 1, startCol)];
+
+    const __m256i empty = _mm256_set1_epi8(EMPTY), rabbit = _mm256_set1_epi8(RABBIT),
+            outside = _mm256_set1_epi8(ROCK);
+
+    const __m256i bits[DIRECTIONS] = {_mm256_set1_epi8(1 << NORTH), _mm256_set1_epi8(1 << EAST),
+                                      _mm256_set1_epi8(1 << SOUTH), _mm256_set1_epi8(1 << WEST)};
+
+    for (int slot = 1; slot < KERNEL_SEGMENT - 1; slot += 32) {
+
+        if (slot > KERNEL_SEGMENT - 1 - 32) slot = KERNEL_SEGMENT - 1 - 32;
+
+        __m256i neighbours[DIRECTIONS] = {
+                !border || north != NULL ? _mm256_loadu_si256((const __m256i *) (north + slot)) : outside,
+                _mm256_loadu_si256((const __m256i *) (current + slot + 1)),
+                !border || south != NULL ? _mm256_loadu_si256((const __m256i *) (south + slot)) : outside,
+                _mm256_loadu_si256((const __m256i *) (current + slot - 1))
+        };
+
+        __m256i rabbits = _mm256_setzero_si256(), empties = _mm256_setzero_si256();
+
+        for (int direction = 0; direction < DIRECTIONS; direction++) {
+            rabbits = _mm256_or_si256(rabbits, _mm256_and_si256(_mm256_cmpeq_epi8(neighbours[direction], rabbit),
+                                                                bits[direction]));
+            empties = _mm256_or_si256(empties, _mm256_and_si256(_mm256_cmpeq_epi8(neighbours[direction], empty),
+                                                                bits[direction]));
+        }
+
+        _mm256_storeu_si256((__m256i *) (rabbitMasks + slot), rabbits);
+        _mm256_storeu_si256((__m256i *) (emptyMasks + slot), empties);
+    }
+
+    if (border) {
+        classifySlot(world, row, startCol, &rabbitMasks[0], &emptyMasks[0]);
+        classifySlot(world, row, startCol + KERNEL_SEGMENT - 1, &rabbitMasks[KERNEL_SEGMENT - 1],
+                     &emptyMasks[KERNEL_SEGMENT - 1]);
+    } else {
+        classifyInteriorSlot(world, row, startCol, &rabbitMasks[0], &emptyMasks[0]);
+        classifyInteriorSlot(world, row, startCol + KERNEL_SEGMENT - 1, &rabbitMasks[KERNEL_SEGMENT - 1],
+                             &emptyMasks[KERNEL_SEGMENT - 1]);
+    }
+}
+
+__attribute__((target("avx2")))
+static void classifyAVX2(World *world, int row, int startCol, uint8_t *rabbitMasks, uint8_t *emptyMasks) {
+
+    if (world->columns - startCol < KERNEL_SEGMENT) {
+        classifyScalar(world, row, startCol, rabbitMasks, emptyMasks);
+    } else if (isInteriorSegment(world, row, startCol)) {
+        classifySegmentAVX2(world, row, startCol, rabbitMasks, emptyMasks, 0);
+    } else {
+        classifySegmentAVX2(world, row, startCol, rabbitMasks, emptyMasks, 1);
+    }
+}
+
+#endif
+
+NeighbourKernelType getBestNeighbourKernel(void) {
+
+#ifdef X86_KERNELS
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        return AVX2_KERNEL;
+    }
+
+    if (__builtin_cpu_supports("sse2")) {
+        return SSE2_KERNEL;
+    }
+#endif
+
+    return SCALAR_KERNEL;
+}
+
+NeighbourKernel getNeighbourKernel(NeighbourKernelType type) {
+
+    switch (type) {
+        case SCALAR_KERNEL:
+            return classifyScalar;
+#ifdef X86_KERNELS
+        case SSE2_KERNEL:
+            __builtin_cpu_init();
+
+            return __builtin_cpu_supports("sse2") ? classifySSE2 : NULL;
+        case AVX2_KERNEL:
+            __builtin_cpu_init();
+
+            return __builtin_cpu_supports("avx2") ? classifyAVX2 : NULL;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+const char *getNeighbourKernelName(NeighbourKernelType type) {
+
+    switch (type) {
+        case SCALAR_KERNEL:
+            return "scalar";
+        case SSE2_KERNEL:
+            return "sse2";
+        case AVX2_KERNEL:
+            return "avx2";
+        default:
+            return "unknown";
+    }
+}
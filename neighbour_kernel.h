@@ -0,0 +1,43 @@
+#ifndef TRABALHO_2_NEIGHBOUR_KERNEL_H
+#define TRABALHO_2_NEIGHBOUR_KERNEL_H
+
+#include <stdint.h>
+#include "rabbitsandfoxes.h"
+
+/*
+ * The neighbours of a segment of a row are classified at once, instead of looking at the 4 neighbours of each
+ * entity separately. Segments start at a multiple of KERNEL_SEGMENT, so they are contiguous in both matrix layouts.
+ */
+#define KERNEL_SEGMENT 64
+
+/**
+ * Classify the neighbours of the slots of the segment of row that starts at startCol (The last segment of a row
+ * can be shorter).
+ *
+ * For each slot, bit i of rabbitMasks is set when the neighbour in direction i (See MoveDirection) is a rabbit,
+ * and bit i of emptyMasks when it's empty. Neighbours outside the world are neither.
+ */
+typedef void (*NeighbourKernel)(World *world, int row, int startCol, uint8_t *rabbitMasks, uint8_t *emptyMasks);
+
+typedef enum NeighbourKernelType_ {
+
+    SCALAR_KERNEL = 0,
+    SSE2_KERNEL = 1,
+    AVX2_KERNEL = 2,
+    NEIGHBOUR_KERNEL_TYPES = 3
+
+} NeighbourKernelType;
+
+/**
+ * The fastest kernel this build and CPU support (Checked with CPUID)
+ */
+NeighbourKernelType getBestNeighbourKernel(void);
+
+/**
+ * The kernel of the type, NULL if it's not supported by this build or CPU
+ */
+NeighbourKernel getNeighbourKernel(NeighbourKernelType type);
+
+const char *getNeighbourKernelName(NeighbourKernelType type);
+
+#endif //TRABALHO_2_NEIGHBOUR_KERNEL_H
@@ -0,0 +1,100 @@
+#include "perf_counters.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define HW_CACHE_EVENT(cache, op, result) ((cache) | ((op) << 8) | ((result) << 16))
+
+static const struct {
+    unsigned int type;
+
+    unsigned long long config;
+
+    const char *name;
+} COUNTERS[PERF_COUNTER_COUNT] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES, "Cache references"},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,     "Cache misses"},
+        {PERF_TYPE_HW_CACHE, HW_CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+                                            PERF_COUNT_HW_CACHE_RESULT_ACCESS), "dTLB loads"},
+        {PERF_TYPE_HW_CACHE, HW_CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+                                            PERF_COUNT_HW_CACHE_RESULT_MISS), "dTLB load misses"},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS, "Branches"},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,       "Branch misses"},
+};
+
+static int openCounter(unsigned int type, unsigned long long config) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    //Count the threads that are created after this as well
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+void startPerfCounters(PerfCounters *counters) {
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        counters->values[i] = -1;
+        counters->fds[i] = openCounter(COUNTERS[i].type, COUNTERS[i].config);
+    }
+
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        if (counters->fds[i] >= 0) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(counters->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+/*
+ * Must be called after the threads that should be counted have been joined,
+ * as the counts of inherited counters are only added when the threads exit
+ */
+void stopPerfCounters(PerfCounters *counters) {
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        if (counters->fds[i] < 0) continue;
+
+        ioctl(counters->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+
+        long long value;
+
+        if (read(counters->fds[i], &value, sizeof(value)) == sizeof(value)) {
+            counters->values[i] = value;
+        }
+
+        close(counters->fds[i]);
+        counters->fds[i] = -1;
+    }
+}
+
+static void printMissRate(FILE *outputFile, PerfCounters *counters, PerfCounter misses, PerfCounter total) {
+    if (counters->values[misses] < 0) {
+        fprintf(outputFile, "%s: unavailable\n", COUNTERS[misses].name);
+    } else if (counters->values[total] <= 0) {
+        fprintf(outputFile, "%s: %lld\n", COUNTERS[misses].name, counters->values[misses]);
+    } else {
+        fprintf(outputFile, "%s: %lld (%.2f%% of %lld %s)\n", COUNTERS[misses].name, counters->values[misses],
+                100.0 * (double) counters->values[misses] / (double) counters->values[total],
+                counters->values[total], COUNTERS[total].name);
+    }
+}
+
+void printPerfCounters(FILE *outputFile, PerfCounters *counters) {
+    printMissRate(outputFile, counters, CACHE_MISSES, CACHE_REFERENCES);
+    printMissRate(outputFile, counters, DTLB_LOAD_MISSES, DTLB_LOADS);
+    printMissRate(outputFile, counters, BRANCH_MISSES, BRANCH_INSTRUCTIONS);
+}
+
+long long getPerfCounter(PerfCounters *counters, PerfCounter counter) {
+    return counters->values[counter];
+}
@@ -0,0 +1,40 @@
+#ifndef TRABALHO_2_PERF_COUNTERS_H
+#define TRABALHO_2_PERF_COUNTERS_H
+
+#include <stdio.h>
+
+typedef enum PerfCounter_ {
+    CACHE_REFERENCES = 0,
+    CACHE_MISSES = 1,
+    DTLB_LOADS = 2,
+    DTLB_LOAD_MISSES = 3,
+    BRANCH_INSTRUCTIONS = 4,
+    BRANCH_MISSES = 5,
+    PERF_COUNTER_COUNT = 6
+} PerfCounter;
+
+/**
+ * Hardware counters for the whole process (Including the threads created after they are started)
+ *
+ * Counters the kernel doesn't let us open (No PMU, perf_event_paranoid, ...) are reported as unavailable
+ */
+typedef struct PerfCounters_ {
+
+    int fds[PERF_COUNTER_COUNT];
+
+    long long values[PERF_COUNTER_COUNT];
+
+} PerfCounters;
+
+void startPerfCounters(PerfCounters *counters);
+
+void stopPerfCounters(PerfCounters *counters);
+
+void printPerfCounters(FILE *outputFile, PerfCounters *counters);
+
+/**
+ * The value of the counter, -1 if it was unavailable
+ */
+long long getPerfCounter(PerfCounters *counters, PerfCounter counter);
+
+#endif //TRABALHO_2_PERF_COUNTERS_H
@@ -4,6 +4,9 @@
 #include <string.h>
 #include "movements.h"
 #include "threads.h"
+#include "perf_counters.h"
+#include "entity_index.h"
+#include "neighbour_kernel.h"
 #include <sys/time.h>
 
 #define MAX_NAME_LENGTH 6
@@ -14,7 +17,7 @@ struct InitialInputData {
 
     InputData *inputData;
 
-    WorldSlot *world;
+    World *world, *nextWorld;
 
     struct ThreadedData *threadedData;
 
@@ -23,91 +26,464 @@ struct InitialInputData {
     int printOutput;
 };
 
-static int handleMoveRabbit(RabbitInfo *info, WorldSlot *newSlot);
+struct SimulationPool_ {
 
-static int handleMoveFox(FoxInfo *foxInfo, WorldSlot *newSlot);
+    int maxThreads;
 
-void printPrettyAllGen(FILE *, InputData *, WorldSlot *);
+    pthread_t *workers;
 
-void performSequentialGeneration(int genNumber, InputData *inputData, WorldSlot *world);
+    //The work each worker is handed in a run (NULL wakes the worker up to exit), and the semaphores they are parked on
+    struct InitialInputData **jobs;
 
-static FoxInfo *initFoxInfo() {
+    sem_t *startSemaphores;
 
-    FoxInfo *foxInfo = malloc(sizeof(FoxInfo));
+    //Posted by each worker when it's done with its work
+    sem_t doneSemaphore;
 
-    foxInfo->currentGenFood = 0;
-    foxInfo->currentGenProc = 0;
-    foxInfo->genUpdated = 0;
-    foxInfo->prevGenProc = 0;
+    //Kept for every run, made for maxThreads threads by the first one
+    struct ThreadedData *threadedData;
+};
+
+//The index of each worker of a pool, handed to it when it's created
+struct PoolWorker {
+
+    SimulationPool *pool;
+
+    int workerNumber;
+};
+
+static int handleMoveRabbit(int genNumber, EntityInfo *rabbit, World *world, int newRow, int newCol);
+
+static int handleMoveFox(int genNumber, EntityInfo *fox, World *world, int newRow, int newCol);
 
-    return foxInfo;
+void printPrettyAllGen(FILE *, InputData *, World *);
+
+void performSequentialGeneration(int genNumber, InputData *inputData, World *world, World *nextWorld);
+
+static void initEntity(EntityInfo *entity, SlotContent content, int genNumber) {
+    entity->slotContent = content;
+    entity->genUpdated = genNumber & 1;
+    entity->currentGenFood = 0;
+    entity->currentGenProc = 0;
 }
 
-static RabbitInfo *initRabbitInfo() {
-    RabbitInfo *rabbitInfo = malloc(sizeof(RabbitInfo));
+//The amount of bytes a slot takes up across all of the planes of the (dynamic) world
+#define WORLD_SLOT_SIZE (sizeof(uint32_t) + sizeof(uint16_t) + 2 * sizeof(uint8_t))
+
+/*
+ * The gather engine decides the moves of the animals of a row before the slots of the row above it pull the animals
+ * in, so it keeps the decisions of the rows above, below and at the row being written
+ */
+#define GATHER_WINDOW 3
+
+/*
+ * The rows on each side of a strip that the gather engine reads (The moves of the row just outside of the strip
+ * depend on the row after it)
+ */
+#define GATHER_REACH 2
+
+/*
+ * The gather engine only waits for the threads next to it between generations, so the threads are balanced again
+ * once every REBALANCE_GENERATIONS generations, when every thread is at the same one
+ */
+#define REBALANCE_GENERATIONS 8
+
+/**
+ * Split storage (with WORLD_SLOT_SIZE bytes for each slot) into the planes of a world with the given size.
+ *
+ * The planes are laid out from the largest to the smallest element size so that all of them are aligned,
+ * meaning the storage starts at the currentGenProc plane.
+ */
+static void initWorldPlanes(World *world, int rows, int columns, WorldTopology *topology, void *storage) {
+    size_t slots = MATRIX_SLOTS(rows, columns);
+
+    world->rows = rows;
+    world->columns = columns;
+    world->topology = topology;
 
-    rabbitInfo->currentGen = 0;
-    rabbitInfo->genUpdated = 0;
-    rabbitInfo->prevGen = 0;
+    world->currentGenProc = (uint32_t *) storage;
+    world->currentGenFood = (uint16_t *) (world->currentGenProc + slots);
+    world->slotContent = (uint8_t *) (world->currentGenFood + slots);
+    world->genUpdated = world->slotContent + slots;
 
-    return rabbitInfo;
+    world->occupiedWordsPerRow = (columns + 63) / 64;
+    world->summaryWordsPerRow = (world->occupiedWordsPerRow + 63) / 64;
+
+    size_t words = (size_t) rows * world->occupiedWordsPerRow;
+
+    //The summary and the species planes are stored right after the bitmap
+    world->occupied = allocPages(sizeof(uint64_t) * (3 * words + (size_t) rows * world->summaryWordsPerRow));
+    world->rabbits = world->occupied + words;
+    world->foxes = world->rabbits + words;
+    world->occupiedSummary = world->foxes + words;
 }
 
-static void freeFoxInfo(FoxInfo *foxInfo) {
-    free(foxInfo);
+/**
+ * Write the entity into the slot, keeping the occupancy bitmap up to date
+ */
+static inline void placeEntity(World *world, int row, int col, EntityInfo *entity) {
+    setEntity(world, PROJECT(world->columns, row, col), entity);
+
+    markOccupied(world, row, col, entity->slotContent);
 }
 
-static void freeRabbitInfo(RabbitInfo *rabbitInfo) {
-    free(rabbitInfo);
+static inline void clearSlot(World *world, int row, int col) {
+    world->slotContent[PROJECT(world->columns, row, col)] = EMPTY;
+
+    markEmpty(world, row, col);
 }
 
-static void
-makeCopyOfPartOfWorld(int threadNumber, InputData *data, struct ThreadedData *threadedData, WorldSlot *toCopy,
-                      WorldSlot *destination,
-                      int copyStartRow, int copyEndRow) {
+/*
+ * The atomic engine keeps the entity that has won a slot of a border row so far in the slot's word of borderSlots,
+ * with the bits of genUpdated above the parity telling if that entity ate the rabbit that was in the slot
+ * (Its food in the word is the one it had before eating it) and which of the moves into the slot came first
+ */
+#define BORDER_ATE 0x2
+
+#define BORDER_RANK_SHIFT 2
+
+/*
+ * The position of the slot a move comes from in ARRIVAL_ORDER, by the direction of the move
+ */
+static const int ARRIVAL_RANK[DIRECTIONS] = {[NORTH] = 3, [EAST] = 1, [SOUTH] = 0, [WEST] = 2};
+
+/**
+ * If the row is next to a border between the rows of two threads (On either side of it) in the atomic engine,
+ * so every write into it has to go through claimBorderSlot
+ */
+static inline int isBorderRow(InputData *inputData, int startRow, int endRow, int row) {
+    return inputData->borderSlots != NULL &&
+           ((row <= startRow && startRow > 0) || (row >= endRow && endRow < inputData->rows - 1));
+}
+
+//The phase a generation writes the species in, counting every phase since the start
+static inline int getBorderPhase(int genNumber, SlotContent species) {
+    return genNumber * 2 + (species == FOX ? 2 : 1);
+}
+
+/**
+ * Same as markOccupied, for the rows that other threads also write to
+ */
+static inline void markOccupiedAtomic(World *world, int row, int col, SlotContent content) {
+    int word = col >> 6, wordIndex = row * world->occupiedWordsPerRow + word;
+
+    uint64_t bit = 1ULL << (col & 63);
+
+    __atomic_fetch_or(&world->occupied[wordIndex], bit, __ATOMIC_RELAXED);
+    __atomic_fetch_or(&world->occupiedSummary[row * world->summaryWordsPerRow + (word >> 6)], 1ULL << (word & 63),
+                      __ATOMIC_RELAXED);
+
+    __atomic_fetch_or(content == RABBIT ? &world->rabbits[wordIndex] : &world->foxes[wordIndex], bit,
+                      __ATOMIC_RELAXED);
+    __atomic_fetch_and(content == RABBIT ? &world->foxes[wordIndex] : &world->rabbits[wordIndex], ~bit,
+                       __ATOMIC_RELAXED);
+}
+
+/**
+ * Move the entity (Already updated for this generation) into a slot of a border row, resolving the collisions with
+ * the moves that have claimed it before with the same rules as handleMoveRabbit and handleMoveFox.
+ *
+ * The slots are claimed in whatever order the threads get to them, so the moves are ranked by where they come from:
+ * only the first one in ARRIVAL_ORDER eats the rabbit in the slot (eats), like it would when run sequentially.
+ * Every other collision keeps the oldest entity, which doesn't depend on the order.
+ *
+ * The world's planes of the slot are only written once every thread is done with the phase (See settleBorderRows)
+ */
+static void claimBorderSlot(int genNumber, InputData *inputData, World *world, int row, int col,
+                            EntityInfo *entity, int rank, int eats) {
+
+    int phase = getBorderPhase(genNumber, entity->slotContent);
+
+    //The thread that owns the row prepares it at the start of its phase, before anything can move into it
+    waitForPhase(&inputData->borderPhases[row], phase, NULL);
+
+    uint64_t *slot = &inputData->borderSlots[PROJECT(inputData->columns, row, col)];
+
+    uint64_t claimed, current = __atomic_load_n(slot, __ATOMIC_RELAXED);
+
+    EntityInfo inSlot;
+
+    do {
+        EntityInfo moving = *entity;
+
+        memcpy(&inSlot, &current, sizeof(EntityInfo));
+
+        int firstRank = inSlot.genUpdated >> BORDER_RANK_SHIFT,
+                first = inSlot.slotContent == EMPTY || rank < firstRank;
+
+        if (first) {
+            firstRank = rank;
+
+            if (eats) {
+                moving.genUpdated |= BORDER_ATE;
+                inSlot.genUpdated &= ~BORDER_ATE;
+            }
+        }
+
+        EntityInfo *winner = &moving;
+
+        if (inSlot.slotContent != EMPTY) {
+            //Compare them with the food they are left with after the rabbit is eaten
+            EntityInfo movingFed = moving, slotFed = inSlot;
+
+            movingFed.genUpdated &= 1;
+            slotFed.genUpdated &= 1;
+
+            if (moving.genUpdated & BORDER_ATE) movingFed.currentGenFood = 0;
+            if (inSlot.genUpdated & BORDER_ATE) slotFed.currentGenFood = 0;
+
+            if (!survivesCollision(genNumber, &movingFed, &slotFed, entity->slotContent == FOX)) {
+                winner = &inSlot;
+            }
+        }
+
+        winner->genUpdated = (uint8_t) ((winner->genUpdated & (1 | BORDER_ATE)) | firstRank << BORDER_RANK_SHIFT);
+
+        memcpy(&claimed, winner, sizeof(EntityInfo));
+
+    } while (!__atomic_compare_exchange_n(slot, &current, claimed, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    //The moves that claim a slot after the first one all leave the same species in it
+    if (inSlot.slotContent == EMPTY) {
+        markOccupiedAtomic(world, row, col, entity->slotContent);
+    }
+}
+
+/**
+ * Keep the entity (Already updated for this generation) that moved into the slot of a border row from its neighbour
+ * at rank in ARRIVAL_ORDER, for settleBorderRows to count. Every neighbour has its own word, so it has a single writer
+ */
+static inline void recordBorderArrival(InputData *inputData, int row, int col, EntityInfo *entity, int rank, int eats) {
+
+    EntityInfo arrival = *entity;
+
+    if (eats) arrival.genUpdated |= BORDER_ATE;
+
+    memcpy(&inputData->borderArrivals[(size_t) PROJECT(inputData->columns, row, col) * DIRECTIONS + rank], &arrival,
+           sizeof(EntityInfo));
+}
+
+/**
+ * Count the moves into the slot of a border row like the other engines count them: the ones into an empty slot and
+ * the ones that survive the animal that moved in before them (Where handleMoveRabbit and handleMoveFox return 1). A
+ * fox that eats the rabbit in the slot isn't, the rabbit already was.
+ *
+ * They are gone through in the order the other engines make them: the moves from our own rows in ARRIVAL_ORDER, then
+ * the ones handed over by the thread above (Into startRow) and by the thread below (Into endRow)
+ */
+static int countBorderArrivals(int genNumber, InputData *inputData, int row, int col, int startRow, int endRow) {
+
+    uint64_t *arrivals = &inputData->borderArrivals[(size_t) PROJECT(inputData->columns, row, col) * DIRECTIONS];
+
+    //The moves from the rows above and below ours are the first and the last ones in ARRIVAL_ORDER
+    int fromAbove = row == startRow, fromBelow = row == endRow, order[DIRECTIONS], moves = 0;
+
+    for (int rank = 0; rank < DIRECTIONS; rank++) {
+        if ((rank == 0 && fromAbove) || (rank == DIRECTIONS - 1 && fromBelow)) continue;
+
+        order[moves++] = rank;
+    }
+
+    if (fromAbove) order[moves++] = 0;
+    if (fromBelow) order[moves++] = DIRECTIONS - 1;
+
+    EntityInfo inSlot;
+
+    int counted = 0, occupied = 0;
+
+    for (int move = 0; move < DIRECTIONS; move++) {
+        uint64_t *arrival = &arrivals[order[move]];
+
+        if (*arrival == 0) continue;
+
+        EntityInfo moving;
+
+        memcpy(&moving, arrival, sizeof(EntityInfo));
+
+        *arrival = 0;
+
+        int ate = !occupied && (moving.genUpdated & BORDER_ATE);
+
+        moving.genUpdated &= 1;
+
+        if (ate) {
+            moving.currentGenFood = 0;
+        } else if (occupied && !survivesCollision(genNumber, &moving, &inSlot, moving.slotContent == FOX)) {
+            continue;
+        } else {
+            counted++;
+        }
+
+        inSlot = moving;
+        occupied = 1;
+    }
+
+    return counted;
+}
+
+/**
+ * Write the entities that won the slots of the border rows of our rows of world into its planes, once every thread
+ * is done claiming them, and count the moves into those rows (The ones from the other threads can't be counted by
+ * the thread that made them)
+ */
+static void settleBorderRows(int genNumber, InputData *inputData, World *world, int startRow, int endRow) {
+
+    if (inputData->borderSlots == NULL) return;
+
+    int borderRows[] = {startRow, endRow};
+
+    for (int border = 0; border < (startRow == endRow ? 1 : 2); border++) {
+        int row = borderRows[border];
+
+        if (!isBorderRow(inputData, startRow, endRow, row)) continue;
+
+        for (int col = 0; col < inputData->columns; col++) {
+            uint64_t *claimed = &inputData->borderSlots[PROJECT(inputData->columns, row, col)];
+
+            if (*claimed == 0) continue;
+
+            EntityInfo entity;
+
+            memcpy(&entity, claimed, sizeof(EntityInfo));
+
+            if (entity.genUpdated & BORDER_ATE) entity.currentGenFood = 0;
+
+            entity.genUpdated &= 1;
 
-//    pthread_barrier_wait(&threadedData->barrier);
+            setEntity(world, PROJECT(inputData->columns, row, col), &entity);
 
-    //postAndWaitForSurrounding(threadNumber, data, threadedData);
+            *claimed = 0;
 
-    int rowCount = (copyEndRow - copyStartRow) + 1;
+            inputData->entitiesPerRow[row] += countBorderArrivals(genNumber, inputData, row, col, startRow, endRow);
+        }
+    }
+}
+
+/**
+ * Find the first slot of the row, starting at col, that is not EMPTY.
+ * Runs of 64 (And 64 * 64) empty slots are skipped with a single test
+ *
+ * @return The column of the slot, -1 if there is none
+ */
+static int nextOccupiedColumn(World *world, int row, int col) {
+
+    uint64_t *occupied = &world->occupied[row * world->occupiedWordsPerRow],
+            *summary = &world->occupiedSummary[row * world->summaryWordsPerRow];
+
+    int word = col >> 6;
+
+    if (word >= world->occupiedWordsPerRow) return -1;
+
+    uint64_t bits = occupied[word] & (~0ULL << (col & 63));
+
+    while (bits == 0) {
+        //Look for the next word with any slot occupied in the summary
+        word++;
+
+        if (word >= world->occupiedWordsPerRow) return -1;
+
+        uint64_t summaryBits = summary[word >> 6] & (~0ULL << (word & 63));
+
+        while (summaryBits == 0) {
+            word = ((word >> 6) + 1) << 6;
+
+            if (word >= world->occupiedWordsPerRow) return -1;
+
+            summaryBits = summary[word >> 6];
+        }
+
+        word = ((word >> 6) << 6) + __builtin_ctzll(summaryBits);
+
+        bits = occupied[word];
+    }
+
+    return (word << 6) + __builtin_ctzll(bits);
+}
+
+/**
+ * Initialize the rows of nextWorld between startRow and endRow with everything in world that does not move in this
+ * phase (The entities of the type staying), without going through the empty slots.
+ *
+ * What was left in those rows the last time nextWorld was written (The slots in staleLists) is cleared first.
+ * The entities that are carried over (Found through worldLists) are added to entities.
+ *
+ * Since entities move at most one row, this has to be done before any entity in these rows is ticked.
+ */
+static void prepareNextWorld(World *world, World *nextWorld, int startRow, int endRow,
+                             EntityList *staleLists, int staleListCount, EntityList *worldLists, int worldListCount,
+                             SlotContent staying, EntityList *entities) {
+
+    EntityCursor cursor;
+
+    int key;
+
+    initEntityCursor(&cursor, staleLists, staleListCount, world->columns, startRow, endRow);
+
+    while ((key = nextEntity(&cursor)) >= 0) {
+        clearSlot(nextWorld, cursor.row, key - cursor.rowKey);
+    }
+
+    initEntityCursor(&cursor, worldLists, worldListCount, world->columns, startRow, endRow);
+
+    while ((key = nextEntity(&cursor)) >= 0) {
+        int slot = PROJECT(world->columns, cursor.row, key - cursor.rowKey);
+
+        if (world->slotContent[slot] == staying) {
+            nextWorld->slotContent[slot] = staying;
+            nextWorld->genUpdated[slot] = world->genUpdated[slot];
+            nextWorld->currentGenFood[slot] = world->currentGenFood[slot];
+            nextWorld->currentGenProc[slot] = world->currentGenProc[slot];
 
-    memcpy(destination, &toCopy[PROJECT(data->columns, copyStartRow, 0)],
-           (rowCount * data->columns * sizeof(WorldSlot)));
+            markOccupied(nextWorld, cursor.row, key - cursor.rowKey, staying);
 
-    if (threadedData != NULL) {
-        //wait for surrounding threads to also complete their copy to allow changes to the tray
-        pthread_barrier_wait(&threadedData->barrier);
+            appendEntity(entities, key);
+        }
     }
+
 }
 
-static void initialRowEntityCount(InputData *inputData, WorldSlot *world) {
+static void initialRowEntityCount(InputData *inputData, World *world) {
 
     int globalCounter = 0;
 
     int rockAmount = 0;
 
+    //The entities we read are the world of the generation before the first one
+    EntityList *entities = &inputData->entityIndex->worldEntities[1][0];
+
+    clearEntityList(entities, 0, inputData->rows - 1);
+
     for (int row = 0; row < inputData->rows; row++) {
 
         int thisRow = 0;
 
-        for (int col = 0; col < inputData->columns; col++) {
-            WorldSlot *worldSlot = &world[PROJECT(inputData->columns, row, col)];
+        if (inputData->entitiesPerBlock != NULL) {
+            memset(&inputData->entitiesPerBlock[row * inputData->columnBlocks], 0,
+                   sizeof(int) * inputData->columnBlocks);
+        }
 
-            struct DefaultMovements defaultMovements = getDefaultPossibleMovements(row, col, inputData, world);
+        for (int col = 0; col < inputData->columns; col++) {
+            int worldSlot = PROJECT(inputData->columns, row, col);
 
-            worldSlot->defaultP = defaultMovements.movementCount;
-            worldSlot->defaultPossibleMoveDirections = defaultMovements.directions;
+            world->topology->defaultMoves[worldSlot] = getDefaultMoveMask(row, col, inputData, world);
 
-            if (worldSlot->slotContent == RABBIT
-                || worldSlot->slotContent == FOX) {
+            if (world->slotContent[worldSlot] == RABBIT
+                || world->slotContent[worldSlot] == FOX) {
 
                 globalCounter++;
 
                 thisRow++;
 
-            } else if (worldSlot->slotContent == ROCK) {
+                if (inputData->entitiesPerBlock != NULL) {
+                    inputData->entitiesPerBlock[row * inputData->columnBlocks + col / TILE_BLOCK_COLUMNS]++;
+                }
+
+                appendEntity(entities, ENTITY_KEY(inputData->columns, row, col));
+
+            } else if (world->slotContent[worldSlot] == ROCK) {
                 rockAmount++;
+
+                world->topology->rocks[row * world->occupiedWordsPerRow + (col >> 6)] |= 1ULL << (col & 63);
             }
         }
 
@@ -131,22 +507,80 @@ InputData *readInputData(FILE *file) {
     fscanf(file, "%d", &inputData->columns);
     fscanf(file, "%d", &inputData->initialPopulation);
 
+#ifdef FIXED_COLUMNS
+    if (inputData->columns != FIXED_COLUMNS) {
+        fprintf(stderr, "This build only supports worlds with %d columns!", FIXED_COLUMNS);
+
+        exit(EXIT_FAILURE);
+    }
+#endif
+
     inputData->entitiesAccumulatedPerRow = malloc(sizeof(int) * (inputData->rows));
     inputData->entitiesPerRow = malloc(sizeof(int) * inputData->rows);
 
     return inputData;
 }
 
-WorldSlot *initWorld(InputData *data) {
+World *initWorld(InputData *data) {
+
+    World *worldMatrix = malloc(sizeof(World));
+
+    WorldTopology *topology = malloc(sizeof(WorldTopology));
+
+    topology->rows = data->rows;
+    topology->columns = data->columns;
+
+    topology->defaultMoves = initMatrix(data->rows, data->columns, sizeof(uint8_t));
 
-    WorldSlot *worldMatrix = (WorldSlot *) initMatrix(data->rows, data->columns, sizeof(WorldSlot));
+    initWorldPlanes(worldMatrix, data->rows, data->columns, topology,
+                    initMatrix(data->rows, data->columns, WORLD_SLOT_SIZE));
+
+    topology->rocks = allocPages(sizeof(uint64_t) * data->rows * worldMatrix->occupiedWordsPerRow);
+
+    data->entityIndex = initEntityIndex(data->threads, data->columns);
+
+    int gathers = data->engine == GATHER_ENGINE || data->engine == FUSED_ENGINE || data->engine == TILED_ENGINE ||
+                  data->engine == STEALING_ENGINE;
+
+    data->moveDecisions = gathers ? malloc(sizeof(uint64_t) * GATHER_WINDOW * DIRECTIONS * 2 * data->threads *
+                                           worldMatrix->occupiedWordsPerRow) : NULL;
+
+    data->borderSlots = data->engine == ATOMIC_ENGINE ? initMatrix(data->rows, data->columns, sizeof(uint64_t)) : NULL;
+    data->borderArrivals = data->engine == ATOMIC_ENGINE ? initMatrix(data->rows, data->columns,
+                                                                      sizeof(uint64_t) * DIRECTIONS) : NULL;
+    data->borderPhases = data->engine == ATOMIC_ENGINE ? calloc(data->rows, sizeof(uint32_t)) : NULL;
+
+    data->columnBlocks = (data->columns + TILE_BLOCK_COLUMNS - 1) / TILE_BLOCK_COLUMNS;
+    data->entitiesPerBlock = data->engine == TILED_ENGINE ? malloc(sizeof(int) * data->rows * data->columnBlocks)
+                                                          : NULL;
 
 //    worldMatrix->entitiesUntilRow = malloc(sizeof(int) * data->rows);
 
     return worldMatrix;
 }
 
-void readWorldInitialData(FILE *file, InputData *data, WorldSlot *world) {
+World *initWorldBuffer(World *world) {
+
+    World *buffer = malloc(sizeof(World));
+
+    initWorldPlanes(buffer, world->rows, world->columns, world->topology,
+                    initMatrix(world->rows, world->columns, WORLD_SLOT_SIZE));
+
+    //The rocks never move, so they are only copied once. Everything else is placed in each phase
+    for (int row = 0; row < world->rows; row++) {
+        for (int col = nextOccupiedColumn(world, row, 0); col >= 0; col = nextOccupiedColumn(world, row, col + 1)) {
+            if (world->slotContent[PROJECT(world->columns, row, col)] == ROCK) {
+                buffer->slotContent[PROJECT(world->columns, row, col)] = ROCK;
+
+                markOccupied(buffer, row, col, ROCK);
+            }
+        }
+    }
+
+    return buffer;
+}
+
+void readWorldInitialData(FILE *file, InputData *data, World *world) {
 
     char entityName[MAX_NAME_LENGTH + 1] = {'\0'};
 
@@ -161,31 +595,31 @@ void readWorldInitialData(FILE *file, InputData *data, WorldSlot *world) {
         fscanf(file, "%d", &entityRow);
         fscanf(file, "%d", &entityColumn);
 
-        WorldSlot *worldSlot = &world[PROJECT(data->columns, entityRow, entityColumn)];
+        int worldSlot = PROJECT(data->columns, entityRow, entityColumn);
+
+        SlotContent content;
 
         if (strcmp("ROCK", entityName) == 0) {
-            worldSlot->slotContent = ROCK;
+            content = ROCK;
         } else if (strcmp("FOX", entityName) == 0) {
-            worldSlot->slotContent = FOX;
+            content = FOX;
         } else if (strcmp("RABBIT", entityName) == 0) {
-            worldSlot->slotContent = RABBIT;
+            content = RABBIT;
         } else {
-            worldSlot->slotContent = EMPTY;
+            content = EMPTY;
         }
 
-        //printf("Reading %d for slot %d, %d\n", worldSlot->slotContent, entityRow, entityColumn);
-
-        switch (worldSlot->slotContent) {
-            case ROCK:
-                break;
-            case FOX:
-                worldSlot->entityInfo.foxInfo = initFoxInfo();
-                break;
-            case RABBIT:
-                worldSlot->entityInfo.rabbitInfo = initRabbitInfo();
-                break;
-            default:
-                break;
+        //printf("Reading %d for slot %d, %d\n", content, entityRow, entityColumn);
+
+        EntityInfo entity;
+
+        //Entities of the initial population start as updated in generation 0
+        initEntity(&entity, content, 0);
+
+        setEntity(world, worldSlot, &entity);
+
+        if (content != EMPTY) {
+            markOccupied(world, entityRow, entityColumn, content);
         }
 
         for (int j = 0; j < MAX_NAME_LENGTH + 1; j++) {
@@ -196,20 +630,24 @@ void readWorldInitialData(FILE *file, InputData *data, WorldSlot *world) {
     initialRowEntityCount(data, world);
 }
 
-void executeSequentialThread(FILE *inputFile, FILE *outputFile) {
+void executeSequentialThread(Engine engine, FILE *inputFile, FILE *outputFile) {
 
     InputData *data = readInputData(inputFile);
 
     data->threads = 1;
+    data->engine = engine;
+    data->neighbourKernel = getNeighbourKernel(getBestNeighbourKernel());
 
     struct ThreadedData *threadedData = malloc(sizeof(struct ThreadedData));
 
     initThreadData(data->threads, data, threadedData);
 
-    WorldSlot *world = initWorld(data);
+    World *world = initWorld(data);
 
     readWorldInitialData(inputFile, data, world);
 
+    World *nextWorld = initWorldBuffer(world);
+
     if (PRINT_ALL_GEN) {
         outputFile = fopen("allgen.txt", "w");
     }
@@ -223,19 +661,20 @@ void executeSequentialThread(FILE *inputFile, FILE *outputFile) {
             fprintf(outputFile, "\n");
         }
 
-        performSequentialGeneration(gen, data, world);
+        performSequentialGeneration(gen, data, world, nextWorld);
     }
 
     printf("RESULTS:\n");
 
     printResults(outputFile, data, world);
     fflush(outputFile);
+    freeWorldBuffer(nextWorld);
     freeWorldMatrix(data, world);
 }
 
 static void executeThread(struct InitialInputData *args) {
 
-    FILE *outputFile;
+    FILE *outputFile = NULL;
 
     if (args->threadNumber == 0 && args->printOutput) {
         outputFile = fopen("allgen.txt", "w");
@@ -246,7 +685,7 @@ static void executeThread(struct InitialInputData *args) {
     for (int gen = 0; gen < args->inputData->n_gen; gen++) {
 
         if (args->printOutput) {
-            pthread_barrier_wait(&args->threadedData->barrier);
+            waitAtTreeBarrier(&args->threadedData->barrier, args->threadNumber);
 
             if (args->threadNumber == 0) {
                 fprintf(outputFile, "Generation %d\n", gen);
@@ -255,11 +694,11 @@ static void executeThread(struct InitialInputData *args) {
                 fprintf(outputFile, "\n");
             }
 
-            pthread_barrier_wait(&args->threadedData->barrier);
+            waitAtTreeBarrier(&args->threadedData->barrier, args->threadNumber);
         }
 
         performGeneration(args->threadNumber, gen, args->inputData,
-                          args->threadedData, args->world, threadRowData);
+                          args->threadedData, args->world, args->nextWorld, threadRowData);
     }
 
     if (args->printOutput && args->threadNumber == 0) {
@@ -268,17 +707,18 @@ static void executeThread(struct InitialInputData *args) {
 
 }
 
-void executeWithThreadCount(int threadCount, FILE *inputFile, FILE *outputFile) {
+/**
+ * Read the world from inputFile for a run with threadCount threads
+ */
+static World *readThreadedWorld(int threadCount, Engine engine, FILE *inputFile, InputData **dataDest) {
 
     InputData *data = readInputData(inputFile);
 
     data->threads = threadCount;
+    data->engine = engine;
+    data->neighbourKernel = getNeighbourKernel(getBestNeighbourKernel());
 
-    struct ThreadedData *threadedData = malloc(sizeof(struct ThreadedData));
-
-    initThreadData(data->threads, data, threadedData);
-
-    WorldSlot *world = initWorld(data);
+    World *world = initWorld(data);
 
     readWorldInitialData(inputFile, data, world);
 
@@ -286,6 +726,39 @@ void executeWithThreadCount(int threadCount, FILE *inputFile, FILE *outputFile)
         exit(EXIT_FAILURE);
     }
 
+    *dataDest = data;
+
+    return world;
+}
+
+/**
+ * Read the world from inputFile for a run with threadCount new threads, with the data they synchronize with
+ */
+static World *readWorldForNewThreads(int threadCount, Engine engine, FILE *inputFile, InputData **dataDest,
+                                     struct ThreadedData **threadedDataDest) {
+
+    World *world = readThreadedWorld(threadCount, engine, inputFile, dataDest);
+
+    struct ThreadedData *threadedData = malloc(sizeof(struct ThreadedData));
+
+    initThreadData(threadCount, *dataDest, threadedData);
+
+    *threadedDataDest = threadedData;
+
+    return world;
+}
+
+/**
+ * Run every generation of the world with the threads of threadedData, created for this run or handed over to the
+ * parked workers of pool (If it's not NULL)
+ *
+ * @return How long it took, in microseconds
+ */
+static long runThreads(InputData *data, struct ThreadedData *threadedData, SimulationPool *pool, World *world,
+                       World *nextWorld) {
+
+    int threadCount = data->threads;
+
     ThreadRowData *threadRowData = malloc(sizeof(ThreadRowData) * threadCount);
 
     struct InitialInputData **inputDataList = malloc(sizeof(struct InitialInputData *) * threadCount);
@@ -303,20 +776,31 @@ void executeWithThreadCount(int threadCount, FILE *inputFile, FILE *outputFile)
         inputData->inputData = data;
         inputData->threadNumber = thread;
         inputData->world = world;
+        inputData->nextWorld = nextWorld;
         inputData->threadedData = threadedData;
         inputData->printOutput = PRINT_ALL_GEN;
         inputData->threadRowData = threadRowData;
 
         inputDataList[thread] = inputData;
 
-        printf("Initializing thread %d \n", thread);
+        if (pool != NULL) {
+            pool->jobs[thread] = inputData;
+
+            sem_post(&pool->startSemaphores[thread]);
+
+            continue;
+        }
 
         pthread_create(&threadedData->threads[thread], NULL, (void *(*)(void *)) executeThread, inputData);
 //        executeThread(inputData);
     }
 
     for (int thread = 0; thread < data->threads; thread++) {
-        pthread_join(threadedData->threads[thread], NULL);
+        if (pool != NULL) {
+            sem_wait(&pool->doneSemaphore);
+        } else {
+            pthread_join(threadedData->threads[thread], NULL);
+        }
     }
 
     gettimeofday(&end, NULL);
@@ -329,400 +813,1641 @@ void executeWithThreadCount(int threadCount, FILE *inputFile, FILE *outputFile)
     }
 
     free(inputDataList);
+    free(threadRowData);
+
+    return micros;
+}
+
+void executeWithThreadCount(int threadCount, Engine engine, FILE *inputFile, FILE *outputFile) {
+
+    InputData *data;
+
+    struct ThreadedData *threadedData;
+
+    World *world = readWorldForNewThreads(threadCount, engine, inputFile, &data, &threadedData);
+
+    World *nextWorld = initWorldBuffer(world);
+
+    for (int thread = 0; thread < threadCount; thread++) {
+        printf("Initializing thread %d \n", thread);
+    }
+
+    PerfCounters perfCounters;
+
+    //Start the counters before the threads are created, so they are inherited by them
+    startPerfCounters(&perfCounters);
+
+    long micros = runThreads(data, threadedData, NULL, world, nextWorld);
+
+    stopPerfCounters(&perfCounters);
 
     printf("RESULTS:\n");
 
     printResults(outputFile, data, world);
     fflush(outputFile);
     printf("Took %ld microseconds\n", micros);
+    printf("Matrix layout: %s\n", MATRIX_LAYOUT);
+    printf("Neighbour kernel: %s\n", getNeighbourKernelName(getBestNeighbourKernel()));
+    printf("World backing: %s (Topology: %s)\n", getPageBackingName(getPageBacking(world->currentGenProc)),
+           getPageBackingName(getPageBacking(world->topology->defaultMoves)));
+    printPerfCounters(stdout, &perfCounters);
+
+    HandshakeCounters handshakeCounters;
+
+    sumHandshakeCounters(threadCount, threadedData, &handshakeCounters);
+    printHandshakeCounters(stdout, &handshakeCounters);
+
+    freeWorldBuffer(nextWorld);
     freeWorldMatrix(data, world);
     freeThreadData(threadCount, threadedData);
 
 }
 
-static void tickRabbit(int genNumber, int startRow, int endRow, int row, int col, WorldSlot *slot,
+long timeWithThreadCount(int threadCount, Engine engine, FILE *inputFile) {
+
+    InputData *data;
+
+    struct ThreadedData *threadedData;
+
+    World *world = readWorldForNewThreads(threadCount, engine, inputFile, &data, &threadedData);
+
+    World *nextWorld = initWorldBuffer(world);
+
+    long micros = runThreads(data, threadedData, NULL, world, nextWorld);
+
+    freeWorldBuffer(nextWorld);
+    freeWorldMatrix(data, world);
+    freeThreadData(threadCount, threadedData);
+
+    return micros;
+}
+
+static void *executePoolWorker(struct PoolWorker *worker) {
+
+    SimulationPool *pool = worker->pool;
+
+    for (;;) {
+        //Parked until the worker is handed the work of a thread
+        sem_wait(&pool->startSemaphores[worker->workerNumber]);
+
+        struct InitialInputData *job = pool->jobs[worker->workerNumber];
+
+        if (job == NULL) break;
+
+        executeThread(job);
+
+        sem_post(&pool->doneSemaphore);
+    }
+
+    free(worker);
+
+    return NULL;
+}
+
+SimulationPool *initSimulationPool(int maxThreads) {
+
+    SimulationPool *pool = malloc(sizeof(SimulationPool));
+
+    pool->maxThreads = maxThreads;
+    pool->threadedData = NULL;
+
+    pool->workers = malloc(sizeof(pthread_t) * maxThreads);
+    pool->jobs = malloc(sizeof(struct InitialInputData *) * maxThreads);
+    pool->startSemaphores = malloc(sizeof(sem_t) * maxThreads);
+
+    sem_init(&pool->doneSemaphore, 0, 0);
+
+    for (int worker = 0; worker < maxThreads; worker++) {
+        struct PoolWorker *poolWorker = malloc(sizeof(struct PoolWorker));
+
+        poolWorker->pool = pool;
+        poolWorker->workerNumber = worker;
+
+        sem_init(&pool->startSemaphores[worker], 0, 0);
+
+        pthread_create(&pool->workers[worker], NULL, (void *(*)(void *)) executePoolWorker, poolWorker);
+    }
+
+    return pool;
+}
+
+long executeWithPool(SimulationPool *pool, int threadCount, Engine engine, FILE *inputFile, FILE *outputFile) {
+
+    if (threadCount > pool->maxThreads) {
+        fprintf(stderr, "The pool only has %d threads!", pool->maxThreads);
+
+        exit(EXIT_FAILURE);
+    }
+
+    InputData *data;
+
+    World *world = readThreadedWorld(threadCount, engine, inputFile, &data);
+
+    if (pool->threadedData == NULL) {
+        pool->threadedData = malloc(sizeof(struct ThreadedData));
+
+        initThreadData(pool->maxThreads, data, pool->threadedData);
+    }
+
+    reuseThreadData(threadCount, data, pool->threadedData);
+
+    World *nextWorld = initWorldBuffer(world);
+
+    long micros = runThreads(data, pool->threadedData, pool, world, nextWorld);
+
+    if (outputFile != NULL) {
+        printResults(outputFile, data, world);
+        fflush(outputFile);
+    }
+
+    freeWorldBuffer(nextWorld);
+    freeWorldMatrix(data, world);
+
+    return micros;
+}
+
+void freeSimulationPool(SimulationPool *pool) {
+
+    for (int worker = 0; worker < pool->maxThreads; worker++) {
+        pool->jobs[worker] = NULL;
+
+        sem_post(&pool->startSemaphores[worker]);
+    }
+
+    for (int worker = 0; worker < pool->maxThreads; worker++) {
+        pthread_join(pool->workers[worker], NULL);
+
+        sem_destroy(&pool->startSemaphores[worker]);
+    }
+
+    sem_destroy(&pool->doneSemaphore);
+
+    if (pool->threadedData != NULL) {
+        freeThreadData(pool->maxThreads, pool->threadedData);
+    }
+
+    free(pool->startSemaphores);
+    free(pool->jobs);
+    free(pool->workers);
+    free(pool);
+}
+
+static void tickRabbit(int genNumber, int startRow, int endRow, int row, int col, EntityInfo *slot,
                        InputData *inputData,
-                       WorldSlot *world,
+                       World *world, EntityList *entities,
                        struct RabbitMovements *possibleRabbitMoves, Conflicts *conflictsForThread) {
 
-    RabbitInfo *rabbitInfo = slot->entityInfo.rabbitInfo;
+    //Work on our own copy of the rabbit, it's written to wherever the rabbit ends up after the move
+    EntityInfo rabbit = *slot;
+
+    int realSlot = PROJECT(inputData->columns, row, col);
+
+    //The slot the rabbit ends up in, -1 if it dies or moves into another thread's rows
+    int destination = realSlot, destinationRow = row, destinationCol = col;
 
     //If there is no moves then the move is successful
-    int movementResult = 1, procriated = 0;
+    int movementResult = 1, procriated = 0, conflict = 0;
+
+    //Where the rabbit moves to (Where it is, if it doesn't move)
+    int newRow = row, newCol = col;
+
+#ifdef VERBOSE
+    printf("Checking rabbit (%d, %d)\n", row, col);
+#endif
+
+    if (possibleRabbitMoves->emptyMovements > 0) {
+
+        int nextPosition = chooseMove(genNumber, row, col, possibleRabbitMoves->emptyMovements);
+
+        MoveDirection direction = possibleRabbitMoves->emptyDirections[nextPosition];
+        newRow = row + DIRECTION_MOVES[direction].x;
+        newCol = col + DIRECTION_MOVES[direction].y;
+
+#ifdef VERBOSE
+        printf("Moving rabbit (%d, %d) with direction %d (Index: %d, Possible: %d) to location %d %d age %d \n", row, col, direction,
+               nextPosition, possibleRabbitMoves->emptyMovements,
+               newRow, newCol, rabbit.currentGenProc);
+#endif
+
+        if (rabbit.currentGenProc >= inputData->gen_proc_rabbits) {
+            //If the rabbit is old enough to procriate we need to leave a rabbit at that location
+
+            //Initialize a new rabbit for that position
+            EntityInfo child;
+
+            initEntity(&child, RABBIT, genNumber);
+            placeEntity(world, row, col, &child);
+            appendEntity(entities, ENTITY_KEY(inputData->columns, row, col));
+            rabbit.genUpdated = genNumber & 1;
+            rabbit.currentGenProc = 0;
+
+            inputData->entitiesPerRow[row]++;
+
+            procriated = 1;
+        } else {
+            clearSlot(world, row, col);
+        }
+
+        if (newRow < startRow || newRow > endRow) {
+            //Conflict, we have to access another thread's memory space, create a conflict
+            //And store it in our conflict list (After the rabbit has been updated)
+            conflict = 1;
+            destination = -1;
+        } else {
+            int newSlot = PROJECT(inputData->columns, newRow, newCol);
+
+            movementResult = handleMoveRabbit(genNumber, &rabbit, world, newRow, newCol);
+
+            if (movementResult == 1) {
+                inputData->entitiesPerRow[newRow]++;
+
+                destination = newSlot;
+                destinationRow = newRow;
+                destinationCol = newCol;
+            } else {
+                destination = -1;
+            }
+        }
+    } else {
+        //No possible movements for the rabbit
+        inputData->entitiesPerRow[row]++;
+
+    }
+
+    //Increment the current after performing the move, but before the conflict resolution, so that
+    //we only generate children in the next generation, but we still have the correct
+    //Number to handle the conflicts
+    if (!procriated) {
+        //Only increment if we did not procriate
+        rabbit.genUpdated = genNumber & 1;
+        rabbit.currentGenProc++;
+    }
+
+    if (conflict) {
+        initAndAppendConflict(conflictsForThread, newRow < startRow, newRow, newCol, &rabbit);
+    } else if (destination >= 0) {
+        placeEntity(world, destinationRow, destinationCol, &rabbit);
+        appendEntity(entities, ENTITY_KEY(inputData->columns, destinationRow, destinationCol));
+    }
+}
+
+static void
+performRabbitGeneration(int threadNumber, int genNumber, InputData *inputData, struct ThreadedData *threadedData,
+                        World *world, World *nextWorld, int startRow, int endRow) {
+
+#ifdef VERBOSE
+    printf("End Row: %d, start row: %d\n", endRow, startRow);
+#endif
+
+    Conflicts *conflictsForThread = NULL;
+
+    if (threadedData != NULL)
+        conflictsForThread = threadedData->conflictPerThreads[threadNumber];
+
+    //First move the rabbits
+
+    struct RabbitMovements possibleRabbitMovesStorage, *possibleRabbitMoves = &possibleRabbitMovesStorage;
+
+    //The neighbours of the segment of the row the last rabbit was in. World is not written in this phase,
+    //so they stay valid for every rabbit in the segment
+    uint8_t rabbitMasks[KERNEL_SEGMENT], emptyMasks[KERNEL_SEGMENT];
+
+    int segmentRow = -1, segmentStart = -1;
+
+    EntityIndex *index = inputData->entityIndex;
+
+    //The lists of the previous generation (That can have been written by any of the partitions) and ours
+    int previous = (genNumber + 1) & 1, current = genNumber & 1;
+
+    EntityList *entities = &index->nextWorldEntities[current][threadNumber];
+
+    clearEntityList(entities, startRow, endRow);
+
+    for (int row = startRow; row <= endRow; row++) {
+        inputData->entitiesPerRow[row] = 0;
+    }
+
+    prepareNextWorld(world, nextWorld, startRow, endRow, index->nextWorldEntities[previous], index->partitions,
+                     index->worldEntities[previous], index->partitions, FOX, entities);
+
+    EntityCursor cursor;
+
+    initEntityCursor(&cursor, index->worldEntities[previous], index->partitions, inputData->columns,
+                     startRow, endRow);
+
+    int key;
+
+    while ((key = nextEntity(&cursor)) >= 0) {
+
+        int row = cursor.row, col = key - cursor.rowKey;
+
+        int slot = PROJECT(inputData->columns, row, col);
+
+        if (world->slotContent[slot] == RABBIT) {
+
+            EntityInfo rabbit;
+
+            getEntity(world, slot, &rabbit);
+
+            if (row != segmentRow || col - segmentStart >= KERNEL_SEGMENT) {
+                segmentRow = row;
+                segmentStart = col & ~(KERNEL_SEGMENT - 1);
+
+                inputData->neighbourKernel(world, row, segmentStart, rabbitMasks, emptyMasks);
+            }
+
+            getRabbitMovementsFromMask(emptyMasks[col - segmentStart], possibleRabbitMoves);
+
+            tickRabbit(genNumber, startRow, endRow, row, col, &rabbit,
+                       inputData, nextWorld, entities, possibleRabbitMoves, conflictsForThread);
+
+        }
+    }
+
+    //Initialize with the conflicts at null because we don't want to access the memory
+    //Until we know it's safe to do so
+    struct ThreadConflictData conflictData = {threadNumber, genNumber, startRow, endRow, inputData,
+                                              nextWorld, threadedData, entities};
+
+    synchronizeThreadAndSolveConflicts(&conflictData);
+
+    sortEntityList(entities, &index->sortBuffers[threadNumber], inputData->columns);
+}
+
+
+static void tickFox(int genNumber, int startRow, int endRow, int row, int col, EntityInfo *slot,
+                    InputData *inputData, World *world, EntityList *entities,
+                    struct FoxMovements *foxMovements, Conflicts *conflictsForThread) {
+
+    //Work on our own copy of the fox, it's written to wherever the fox ends up after the move
+    EntityInfo fox = *slot;
+
+    int realSlot = PROJECT(inputData->columns, row, col);
+
+    //The slot the fox ends up in, -1 if it dies or moves into another thread's rows
+    int destination = realSlot, destinationRow = row, destinationCol = col;
+
+    //If there is no move, the result is positive, as no other animal should try to eat us
+    int foxMovementResult = 1, conflict = 0;
+
+    //Where the fox moves to (Where it is, if it doesn't move)
+    int newRow = row, newCol = col;
+
+    //Since we store the row that's above, we have to compensate with the storagePadding
+
+    //Increment the gen food so the fox dies before moving and after not finding a rabbit to eat
+    fox.currentGenFood++;
+
+#ifdef VERBOSE
+    printf("Checking fox (%d %d) food %d\n", row, col, fox.currentGenFood);
+#endif
+
+    if (foxMovements->rabbitMovements <= 0) {
+        if (fox.currentGenFood >= inputData->gen_food_foxes) {
+            //If the fox gen food reaches the limit, kill it before it moves.
+            clearSlot(world, row, col);
+
+#ifdef VERBOSE
+            printf("Fox on %d %d Starved to death\n", row, col);
+#endif
+
+            return;
+        }
+    }
+
+    int nextPosition;
+
+    MoveDirection direction;
+    int procriated = 0;
+
+    //Can only breed a fox when we are capable of moving
+    if ((foxMovements->emptyMovements > 0 || foxMovements->rabbitMovements > 0)) {
+
+        if (fox.currentGenProc >= inputData->gen_proc_foxes) {
+            EntityInfo child;
+
+            initEntity(&child, FOX, genNumber);
+            placeEntity(world, row, col, &child);
+            appendEntity(entities, ENTITY_KEY(inputData->columns, row, col));
+
+            inputData->entitiesPerRow[row]++;
+
+            fox.genUpdated = genNumber & 1;
+            fox.currentGenProc = 0;
+            procriated = 1;
+        } else {
+            //Clear the slot
+            clearSlot(world, row, col);
+        }
+    }
+
+    if (foxMovements->rabbitMovements > 0) {
+        nextPosition = chooseMove(genNumber, row, col, foxMovements->rabbitMovements);
+
+        direction = foxMovements->rabbitDirections[nextPosition];
+    } else if (foxMovements->emptyMovements > 0) {
+        nextPosition = chooseMove(genNumber, row, col, foxMovements->emptyMovements);
+
+        direction = foxMovements->emptyDirections[nextPosition];
+    }
+
+    if (foxMovements->rabbitMovements > 0 || foxMovements->emptyMovements > 0) {
+        newRow = row + DIRECTION_MOVES[direction].x;
+        newCol = col + DIRECTION_MOVES[direction].y;
+
+        if (newRow < startRow || newRow > endRow) {
+            //Conflict, we have to access another thread's memory space, create a conflict
+            //And store it in our conflict list (After the fox has been updated)
+            conflict = 1;
+            destination = -1;
+        } else {
+            int newSlot = PROJECT(inputData->columns, newRow, newCol);
+
+            foxMovementResult = handleMoveFox(genNumber, &fox, world, newRow, newCol);
+            //We only increment the rows under our control, to avoid concurrency issues
+            if (foxMovementResult == 1) {
+                inputData->entitiesPerRow[newRow]++;
+            }
+
+            destination = foxMovementResult > 0 ? newSlot : -1;
+            destinationRow = newRow;
+            destinationCol = newCol;
+        }
+    } else {
+        inputData->entitiesPerRow[row]++;
+#ifdef VERBOSE
+        printf("FOX at %d %d has no possible movements\n", row, col);
+#endif
+    }
+
+    fox.genUpdated = genNumber & 1;
+
+    if (foxMovementResult == 1 || foxMovementResult == 2) {
+
+        if (!procriated) {
+            //Only increment the procriated when the fox did not replicate
+            //(Or else it would start with 1 extra gen)
+            fox.currentGenProc++;
+        }
+
+        //If the fox eats a rabbit, reset it's current gen food
+        if (foxMovementResult == 2) {
+            fox.currentGenFood = 0;
+        }
+
+    }
+
+    //If the move failed the fox is dead, so it's not written anywhere
+    if (conflict) {
+        initAndAppendConflict(conflictsForThread, newRow < startRow, newRow, newCol, &fox);
+    } else if (destination >= 0) {
+        placeEntity(world, destinationRow, destinationCol, &fox);
+        appendEntity(entities, ENTITY_KEY(inputData->columns, destinationRow, destinationCol));
+    }
+}
+
+static void
+performFoxGeneration(int threadNumber, int genNumber, InputData *inputData, struct ThreadedData *threadedData,
+                     World *world, World *nextWorld, int startRow, int endRow) {
+
+    Conflicts *conflictsForThread = NULL;
+    if (threadedData != NULL)
+        conflictsForThread = threadedData->conflictPerThreads[threadNumber];
+
+    struct FoxMovements foxMovementsStorage, *foxMovements = &foxMovementsStorage;
+
+    uint8_t rabbitMasks[KERNEL_SEGMENT], emptyMasks[KERNEL_SEGMENT];
+
+    int segmentRow = -1, segmentStart = -1;
+
+    EntityIndex *index = inputData->entityIndex;
+
+    int previous = (genNumber + 1) & 1, current = genNumber & 1;
+
+    //The rabbits moved into our rows of world (The buffer we are reading) in this generation's rabbit phase
+    EntityList *movedEntities = &index->nextWorldEntities[current][threadNumber],
+            *entities = &index->worldEntities[current][threadNumber];
+
+    clearEntityList(entities, startRow, endRow);
+
+    prepareNextWorld(world, nextWorld, startRow, endRow, index->worldEntities[previous], index->partitions,
+                     movedEntities, 1, RABBIT, entities);
+
+    EntityCursor cursor;
+
+    initEntityCursor(&cursor, movedEntities, 1, inputData->columns, startRow, endRow);
+
+    int key;
+
+    while ((key = nextEntity(&cursor)) >= 0) {
+
+        int row = cursor.row, col = key - cursor.rowKey;
+
+        int slot = PROJECT(inputData->columns, row, col);
+
+        if (world->slotContent[slot] == FOX) {
+
+            EntityInfo fox;
+
+            getEntity(world, slot, &fox);
+
+            if (row != segmentRow || col - segmentStart >= KERNEL_SEGMENT) {
+                segmentRow = row;
+                segmentStart = col & ~(KERNEL_SEGMENT - 1);
+
+                inputData->neighbourKernel(world, row, segmentStart, rabbitMasks, emptyMasks);
+            }
+
+            getFoxMovementsFromMasks(rabbitMasks[col - segmentStart], emptyMasks[col - segmentStart], foxMovements);
+
+            tickFox(genNumber, startRow, endRow, row, col, &fox,
+                    inputData, nextWorld, entities, foxMovements, conflictsForThread);
+
+        }
+    }
+
+    struct ThreadConflictData conflictData = {threadNumber, genNumber, startRow, endRow, inputData,
+                                              nextWorld, threadedData, entities};
+
+    synchronizeThreadAndSolveConflicts(&conflictData);
+
+    sortEntityList(entities, &index->sortBuffers[threadNumber], inputData->columns);
+}
+
+/**
+ * Initialize the words between startWord and endWord of the row of nextWorld with everything in world that does not
+ * move in this phase (The entities of the type staying), a word of the bit planes at a time.
+ *
+ * Same as prepareNextWorld, but the slots that have to be cleared or carried over are found in the bit planes
+ * instead of the entity index. The words of the summary that cover the segment are written whole, so the segment
+ * has to start (And end) at the start of a word of the summary (Or at the end of the row)
+ */
+static void prepareNextWorldSegment(World *world, World *nextWorld, int row, int startWord, int endWord,
+                                    SlotContent staying) {
+
+    int wordsPerRow = world->occupiedWordsPerRow;
+
+    uint64_t *carriedPlane = staying == FOX ? world->foxes : world->rabbits;
+
+    for (int word = startWord; word <= endWord; word++) {
+
+        int wordIndex = row * wordsPerRow + word;
+
+        uint64_t rocks = world->topology->rocks[wordIndex], carried = carriedPlane[wordIndex];
+
+        //Everything that was left in nextWorld, except for the rocks
+        for (uint64_t stale = nextWorld->occupied[wordIndex] & ~rocks; stale != 0; stale &= stale - 1) {
+            nextWorld->slotContent[PROJECT(world->columns, row, (word << 6) + __builtin_ctzll(stale))] = EMPTY;
+        }
+
+        for (uint64_t bits = carried; bits != 0; bits &= bits - 1) {
+            int slot = PROJECT(world->columns, row, (word << 6) + __builtin_ctzll(bits));
+
+            nextWorld->slotContent[slot] = staying;
+            nextWorld->genUpdated[slot] = world->genUpdated[slot];
+            nextWorld->currentGenFood[slot] = world->currentGenFood[slot];
+            nextWorld->currentGenProc[slot] = world->currentGenProc[slot];
+        }
+
+        nextWorld->occupied[wordIndex] = rocks | carried;
+        nextWorld->rabbits[wordIndex] = staying == RABBIT ? carried : 0;
+        nextWorld->foxes[wordIndex] = staying == FOX ? carried : 0;
+    }
+
+    for (int summaryWord = startWord >> 6; summaryWord <= endWord >> 6; summaryWord++) {
+        uint64_t summary = 0;
+
+        for (int word = summaryWord << 6; word < wordsPerRow && word < (summaryWord + 1) << 6; word++) {
+            if (nextWorld->occupied[row * wordsPerRow + word] != 0) {
+                summary |= 1ULL << (word & 63);
+            }
+        }
+
+        nextWorld->occupiedSummary[row * world->summaryWordsPerRow + summaryWord] = summary;
+    }
+}
+
+/**
+ * Initialize the rows of nextWorld between startRow and endRow with everything in world that does not move in this
+ * phase (See prepareNextWorldSegment)
+ */
+static void prepareNextWorldWords(World *world, World *nextWorld, int startRow, int endRow, SlotContent staying) {
+
+    for (int row = startRow; row <= endRow; row++) {
+        prepareNextWorldSegment(world, nextWorld, row, 0, world->occupiedWordsPerRow - 1, staying);
+    }
+}
+
+/**
+ * prepareNextWorldWords, starting with the border rows in the atomic engine, so the threads next to ours can start
+ * claiming their slots as soon as possible
+ */
+static void prepareBorderRows(int genNumber, InputData *inputData, World *world, World *nextWorld,
+                              int startRow, int endRow, SlotContent staying) {
+
+    if (inputData->borderSlots == NULL) {
+        prepareNextWorldWords(world, nextWorld, startRow, endRow, staying);
+
+        return;
+    }
+
+    int phase = getBorderPhase(genNumber, staying == FOX ? RABBIT : FOX), first = startRow, last = endRow;
+
+    if (isBorderRow(inputData, startRow, endRow, startRow)) {
+        prepareNextWorldWords(world, nextWorld, startRow, startRow, staying);
+
+        publishPhase(&inputData->borderPhases[startRow], phase);
+
+        first++;
+    }
+
+    if (endRow >= first && isBorderRow(inputData, startRow, endRow, endRow)) {
+        prepareNextWorldWords(world, nextWorld, endRow, endRow, staying);
+
+        publishPhase(&inputData->borderPhases[endRow], phase);
+
+        last--;
+    }
+
+    if (first <= last) {
+        prepareNextWorldWords(world, nextWorld, first, last, staying);
+    }
+}
+
+static void
+performRabbitGenerationBitboard(int threadNumber, int genNumber, InputData *inputData,
+                                struct ThreadedData *threadedData, World *world, World *nextWorld,
+                                int startRow, int endRow) {
+
+    Conflicts *conflictsForThread = NULL;
+
+    if (threadedData != NULL)
+        conflictsForThread = threadedData->conflictPerThreads[threadNumber];
+
+    struct RabbitMovements possibleRabbitMoves;
+
+    struct NeighbourMasks emptyMasks;
+
+    for (int row = startRow; row <= endRow; row++) {
+        inputData->entitiesPerRow[row] = 0;
+    }
+
+    prepareNextWorldWords(world, nextWorld, startRow, endRow, FOX);
+
+    for (int row = startRow; row <= endRow; row++) {
+
+        for (int word = 0; word < world->occupiedWordsPerRow; word++) {
+
+            uint64_t rabbits = world->rabbits[row * world->occupiedWordsPerRow + word];
+
+            if (rabbits == 0) continue;
+
+            //World is not written in this phase, so the moves of every rabbit in the word can be found at once
+            getNeighbourMasks(world, world->occupied, 1, row, word, &emptyMasks);
+
+            for (; rabbits != 0; rabbits &= rabbits - 1) {
+                int bit = __builtin_ctzll(rabbits), col = (word << 6) + bit;
+
+                EntityInfo rabbit;
+
+                getEntity(world, PROJECT(inputData->columns, row, col), &rabbit);
+
+                getRabbitMovementsFromMask(getMoveMask(&emptyMasks, bit), &possibleRabbitMoves);
+
+                tickRabbit(genNumber, startRow, endRow, row, col, &rabbit,
+                           inputData, nextWorld, NULL, &possibleRabbitMoves, conflictsForThread);
+            }
+        }
+    }
+
+    struct ThreadConflictData conflictData = {threadNumber, genNumber, startRow, endRow, inputData,
+                                              nextWorld, threadedData, NULL};
+
+    synchronizeThreadAndSolveConflicts(&conflictData);
+}
+
+static void
+performFoxGenerationBitboard(int threadNumber, int genNumber, InputData *inputData,
+                             struct ThreadedData *threadedData, World *world, World *nextWorld,
+                             int startRow, int endRow) {
+
+    Conflicts *conflictsForThread = NULL;
+
+    if (threadedData != NULL)
+        conflictsForThread = threadedData->conflictPerThreads[threadNumber];
+
+    struct FoxMovements foxMovements;
+
+    struct NeighbourMasks rabbitMasks, emptyMasks;
+
+    prepareNextWorldWords(world, nextWorld, startRow, endRow, RABBIT);
+
+    for (int row = startRow; row <= endRow; row++) {
+
+        for (int word = 0; word < world->occupiedWordsPerRow; word++) {
+
+            uint64_t foxes = world->foxes[row * world->occupiedWordsPerRow + word];
+
+            if (foxes == 0) continue;
+
+            getNeighbourMasks(world, world->rabbits, 0, row, word, &rabbitMasks);
+            getNeighbourMasks(world, world->occupied, 1, row, word, &emptyMasks);
+
+            for (; foxes != 0; foxes &= foxes - 1) {
+                int bit = __builtin_ctzll(foxes), col = (word << 6) + bit;
+
+                EntityInfo fox;
+
+                getEntity(world, PROJECT(inputData->columns, row, col), &fox);
+
+                getFoxMovementsFromMasks(getMoveMask(&rabbitMasks, bit), getMoveMask(&emptyMasks, bit),
+                                         &foxMovements);
+
+                tickFox(genNumber, startRow, endRow, row, col, &fox,
+                        inputData, nextWorld, NULL, &foxMovements, conflictsForThread);
+            }
+        }
+    }
+
+    struct ThreadConflictData conflictData = {threadNumber, genNumber, startRow, endRow, inputData,
+                                              nextWorld, threadedData, NULL};
+
+    synchronizeThreadAndSolveConflicts(&conflictData);
+}
+
+/**
+ * Same as tickRabbit, for the atomic engine: a rabbit that moves into a border row (Ours or of the threads next to
+ * ours) claims its slot (See claimBorderSlot) instead of writing it, so no move is handed over as a conflict
+ */
+static void tickRabbitAtomic(int genNumber, int startRow, int endRow, int row, int col, EntityInfo *slot,
+                             InputData *inputData, World *world, struct RabbitMovements *possibleRabbitMoves) {
+
+    EntityInfo rabbit = *slot;
+
+    //Where the rabbit moves to (Where it is, if it doesn't move), and where it comes from (See ARRIVAL_RANK)
+    int newRow = row, newCol = col, rank = 0;
+
+    int movementResult = 1, procriated = 0;
+
+    //The border rows are only written by the claims, so a rabbit in one was never written there
+    int border = isBorderRow(inputData, startRow, endRow, row);
+
+    if (possibleRabbitMoves->emptyMovements > 0) {
+
+        int nextPosition = chooseMove(genNumber, row, col, possibleRabbitMoves->emptyMovements);
+
+        MoveDirection direction = possibleRabbitMoves->emptyDirections[nextPosition];
+
+        newRow = row + DIRECTION_MOVES[direction].x;
+        newCol = col + DIRECTION_MOVES[direction].y;
+        rank = ARRIVAL_RANK[direction];
+
+        if (rabbit.currentGenProc >= inputData->gen_proc_rabbits) {
+            EntityInfo child;
+
+            initEntity(&child, RABBIT, genNumber);
+
+            if (border) {
+                claimBorderSlot(genNumber, inputData, world, row, col, &child, 0, 0);
+            } else {
+                placeEntity(world, row, col, &child);
+            }
+
+            rabbit.genUpdated = genNumber & 1;
+            rabbit.currentGenProc = 0;
+
+            inputData->entitiesPerRow[row]++;
+
+            procriated = 1;
+        } else if (!border) {
+            clearSlot(world, row, col);
+        }
+
+        border = isBorderRow(inputData, startRow, endRow, newRow);
+
+        //The moves into a border row are claimed once the rabbit has been updated
+        if (!border) {
+            movementResult = handleMoveRabbit(genNumber, &rabbit, world, newRow, newCol);
+
+            if (movementResult == 1) {
+                inputData->entitiesPerRow[newRow]++;
+            }
+        }
+    } else {
+        inputData->entitiesPerRow[row]++;
+    }
+
+    if (!procriated) {
+        rabbit.genUpdated = genNumber & 1;
+        rabbit.currentGenProc++;
+    }
+
+    if (border) {
+        claimBorderSlot(genNumber, inputData, world, newRow, newCol, &rabbit, rank, 0);
+
+        //Only the thread that owns the row can count the move, once every move into it has been made. The claim has
+        //already waited for the row to be ready for it
+        if (possibleRabbitMoves->emptyMovements > 0) {
+            recordBorderArrival(inputData, newRow, newCol, &rabbit, rank, 0);
+        }
+    } else if (movementResult == 1) {
+        placeEntity(world, newRow, newCol, &rabbit);
+    }
+}
+
+/**
+ * Same as tickFox, for the atomic engine (See tickRabbitAtomic)
+ */
+static void tickFoxAtomic(int genNumber, int startRow, int endRow, int row, int col, EntityInfo *slot,
+                          InputData *inputData, World *world, struct FoxMovements *foxMovements) {
+
+    EntityInfo fox = *slot;
+
+    //Where the fox moves to (Where it is, if it doesn't move), and where it comes from (See ARRIVAL_RANK)
+    int newRow = row, newCol = col, rank = 0;
+
+    int foxMovementResult = 1, procriated = 0;
+
+    //The border rows are only written by the claims, so a fox in one was never written there
+    int border = isBorderRow(inputData, startRow, endRow, row);
+
+    fox.currentGenFood++;
+
+    if (foxMovements->rabbitMovements <= 0 && fox.currentGenFood >= inputData->gen_food_foxes) {
+        if (!border) clearSlot(world, row, col);
+
+        return;
+    }
+
+    if (foxMovements->rabbitMovements > 0 || foxMovements->emptyMovements > 0) {
+
+        if (fox.currentGenProc >= inputData->gen_proc_foxes) {
+            EntityInfo child;
+
+            initEntity(&child, FOX, genNumber);
+
+            if (border) {
+                claimBorderSlot(genNumber, inputData, world, row, col, &child, 0, 0);
+            } else {
+                placeEntity(world, row, col, &child);
+            }
+
+            inputData->entitiesPerRow[row]++;
+
+            fox.genUpdated = genNumber & 1;
+            fox.currentGenProc = 0;
+            procriated = 1;
+        } else if (!border) {
+            clearSlot(world, row, col);
+        }
+
+        MoveDirection direction;
+
+        if (foxMovements->rabbitMovements > 0) {
+            direction = foxMovements->rabbitDirections[chooseMove(genNumber, row, col,
+                                                                  foxMovements->rabbitMovements)];
+        } else {
+            direction = foxMovements->emptyDirections[chooseMove(genNumber, row, col,
+                                                                 foxMovements->emptyMovements)];
+        }
+
+        newRow = row + DIRECTION_MOVES[direction].x;
+        newCol = col + DIRECTION_MOVES[direction].y;
+        rank = ARRIVAL_RANK[direction];
+
+        border = isBorderRow(inputData, startRow, endRow, newRow);
+
+        //The moves into a border row are claimed once the fox has been updated. Whether it gets to eat the rabbit
+        //is only known then
+        if (!border) {
+            foxMovementResult = handleMoveFox(genNumber, &fox, world, newRow, newCol);
+
+            if (foxMovementResult == 1) {
+                inputData->entitiesPerRow[newRow]++;
+            }
+        }
+    } else {
+        inputData->entitiesPerRow[row]++;
+    }
+
+    fox.genUpdated = genNumber & 1;
+
+    if (foxMovementResult == 1 || foxMovementResult == 2) {
+
+        if (!procriated) {
+            fox.currentGenProc++;
+        }
+
+        if (foxMovementResult == 2) {
+            fox.currentGenFood = 0;
+        }
+    }
+
+    //If the move failed the fox is dead, so it's not written anywhere
+    if (border) {
+        claimBorderSlot(genNumber, inputData, world, newRow, newCol, &fox, rank, foxMovements->rabbitMovements > 0);
+
+        if (foxMovements->rabbitMovements > 0 || foxMovements->emptyMovements > 0) {
+            recordBorderArrival(inputData, newRow, newCol, &fox, rank, foxMovements->rabbitMovements > 0);
+        }
+    } else if (foxMovementResult > 0) {
+        placeEntity(world, newRow, newCol, &fox);
+    }
+}
+
+/**
+ * If an animal in the row can move into (Or is in) a border row of the atomic engine, so it has to go through
+ * tickRabbitAtomic or tickFoxAtomic
+ */
+static inline int isNearBorderRow(int startRow, int endRow, int row) {
+    return row <= startRow + 1 || row >= endRow - 1;
+}
+
+/**
+ * Same as performRabbitGenerationBitboard, for the atomic engine. The moves into the rows of the threads next to ours
+ * are claimed right away, so there are no conflicts to hand over after the phase
+ */
+static void performRabbitGenerationAtomic(int genNumber, InputData *inputData, World *world, World *nextWorld,
+                                          int startRow, int endRow) {
+
+    struct RabbitMovements possibleRabbitMoves;
+
+    struct NeighbourMasks emptyMasks;
+
+    for (int row = startRow; row <= endRow; row++) {
+        inputData->entitiesPerRow[row] = 0;
+    }
+
+    prepareBorderRows(genNumber, inputData, world, nextWorld, startRow, endRow, FOX);
+
+    for (int row = startRow; row <= endRow; row++) {
+
+        int nearBorder = isNearBorderRow(startRow, endRow, row);
+
+        for (int word = 0; word < world->occupiedWordsPerRow; word++) {
+
+            uint64_t rabbits = world->rabbits[row * world->occupiedWordsPerRow + word];
+
+            if (rabbits == 0) continue;
+
+            getNeighbourMasks(world, world->occupied, 1, row, word, &emptyMasks);
+
+            for (; rabbits != 0; rabbits &= rabbits - 1) {
+                int bit = __builtin_ctzll(rabbits), col = (word << 6) + bit;
+
+                EntityInfo rabbit;
+
+                getEntity(world, PROJECT(inputData->columns, row, col), &rabbit);
+
+                getRabbitMovementsFromMask(getMoveMask(&emptyMasks, bit), &possibleRabbitMoves);
+
+                if (nearBorder) {
+                    tickRabbitAtomic(genNumber, startRow, endRow, row, col, &rabbit, inputData, nextWorld,
+                                     &possibleRabbitMoves);
+                } else {
+                    //The rabbits further away from the borders never leave our rows
+                    tickRabbit(genNumber, startRow, endRow, row, col, &rabbit,
+                               inputData, nextWorld, NULL, &possibleRabbitMoves, NULL);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Same as performFoxGenerationBitboard, for the atomic engine (See performRabbitGenerationAtomic)
+ */
+static void performFoxGenerationAtomic(int genNumber, InputData *inputData, World *world, World *nextWorld,
+                                       int startRow, int endRow) {
+
+    struct FoxMovements foxMovements;
+
+    struct NeighbourMasks rabbitMasks, emptyMasks;
+
+    prepareBorderRows(genNumber, inputData, world, nextWorld, startRow, endRow, RABBIT);
+
+    for (int row = startRow; row <= endRow; row++) {
+
+        int nearBorder = isNearBorderRow(startRow, endRow, row);
+
+        for (int word = 0; word < world->occupiedWordsPerRow; word++) {
+
+            uint64_t foxes = world->foxes[row * world->occupiedWordsPerRow + word];
+
+            if (foxes == 0) continue;
+
+            getNeighbourMasks(world, world->rabbits, 0, row, word, &rabbitMasks);
+            getNeighbourMasks(world, world->occupied, 1, row, word, &emptyMasks);
+
+            for (; foxes != 0; foxes &= foxes - 1) {
+                int bit = __builtin_ctzll(foxes), col = (word << 6) + bit;
+
+                EntityInfo fox;
+
+                getEntity(world, PROJECT(inputData->columns, row, col), &fox);
+
+                getFoxMovementsFromMasks(getMoveMask(&rabbitMasks, bit), getMoveMask(&emptyMasks, bit),
+                                         &foxMovements);
+
+                if (nearBorder) {
+                    tickFoxAtomic(genNumber, startRow, endRow, row, col, &fox, inputData, nextWorld, &foxMovements);
+                } else {
+                    tickFox(genNumber, startRow, endRow, row, col, &fox,
+                            inputData, nextWorld, NULL, &foxMovements, NULL);
+                }
+            }
+        }
+    }
+}
+
+/*
+ * The neighbours that can move into a slot, in the order their ticks run in the other engines (Row major)
+ */
+static const MoveDirection ARRIVAL_ORDER[DIRECTIONS] = {NORTH, WEST, EAST, SOUTH};
+
+/**
+ * The moves decided in the row: a plane per direction, with the bits of the animals that move in that direction
+ */
+static inline uint64_t *getDecisionRow(uint64_t *decisions, int wordsPerRow, int row) {
+    return &decisions[(size_t) (row % GATHER_WINDOW) * DIRECTIONS * wordsPerRow];
+}
+
+/**
+ * Decide the moves of the animals of the species in the words between startWord and endWord of the row of world,
+ * without writing to any world. The animals that don't move (Or starve) are not in any of the planes
+ */
+static void decideMovesForSegment(int genNumber, InputData *inputData, World *world, SlotContent species, int row,
+                                  int startWord, int endWord, uint64_t *decisions) {
+
+    int wordsPerRow = world->occupiedWordsPerRow;
+
+    uint64_t *plane = species == RABBIT ? world->rabbits : world->foxes;
+
+    struct NeighbourMasks rabbitMasks, emptyMasks;
+
+    for (int direction = 0; direction < DIRECTIONS; direction++) {
+        memset(&decisions[direction * wordsPerRow + startWord], 0, sizeof(uint64_t) * (endWord - startWord + 1));
+    }
+
+    for (int word = startWord; word <= endWord; word++) {
+
+        uint64_t animals = plane[row * wordsPerRow + word];
+
+        if (animals == 0) continue;
+
+        getNeighbourMasks(world, world->occupied, 1, row, word, &emptyMasks);
+
+        if (species == FOX) {
+            getNeighbourMasks(world, world->rabbits, 0, row, word, &rabbitMasks);
+        }
+
+        for (; animals != 0; animals &= animals - 1) {
+            int bit = __builtin_ctzll(animals), col = (word << 6) + bit;
+
+            int mask = getMoveMask(&emptyMasks, bit);
+
+            if (species == FOX) {
+                int rabbitMask = getMoveMask(&rabbitMasks, bit);
+
+                //Same as tickFox: the food is incremented before checking if the fox starves
+                if (rabbitMask == 0 &&
+                    world->currentGenFood[PROJECT(world->columns, row, col)] + 1 >= inputData->gen_food_foxes) {
+                    continue;
+                }
+
+                //Foxes always go for a rabbit when they can
+                if (rabbitMask != 0) mask = rabbitMask;
+            }
+
+            int count = MASK_MOVE_COUNT[mask];
+
+            if (count > 0) {
+                MoveDirection direction = MASK_DIRECTIONS[mask][chooseMove(genNumber, row, col, count)];
+
+                decisions[direction * wordsPerRow + word] |= 1ULL << bit;
+            }
+        }
+    }
+}
+
+/**
+ * decideMovesForSegment, for every word of the row
+ */
+static void decideMovesForRow(int genNumber, InputData *inputData, World *world, SlotContent species, int row,
+                              uint64_t *decisions) {
+    decideMovesForSegment(genNumber, inputData, world, species, row, 0, world->occupiedWordsPerRow - 1, decisions);
+}
+
+/**
+ * The animal in the slot of world did not move away from it, write it into nextWorld
+ *
+ * @return 1 if it's still alive
+ */
+static int stayInSlot(int genNumber, InputData *inputData, World *world, World *nextWorld, int row, int col) {
+
+    EntityInfo entity;
+
+    getEntity(world, PROJECT(world->columns, row, col), &entity);
+
+    if (entity.slotContent == FOX) {
+        entity.currentGenFood++;
+
+        if (entity.currentGenFood >= inputData->gen_food_foxes) return 0;
+    }
+
+    entity.genUpdated = genNumber & 1;
+    entity.currentGenProc++;
+
+    placeEntity(nextWorld, row, col, &entity);
+
+    return 1;
+}
+
+/**
+ * The animal in the slot of world moved away from it, leave its child behind if it's old enough
+ *
+ * @return 1 if there's a child
+ */
+static int leaveSlot(int genNumber, InputData *inputData, World *world, World *nextWorld, int row, int col) {
+
+    int slot = PROJECT(world->columns, row, col);
+
+    SlotContent species = world->slotContent[slot];
+
+    int genProc = species == RABBIT ? inputData->gen_proc_rabbits : inputData->gen_proc_foxes;
 
-#ifdef VERBOSE
-    printf("Checking rabbit (%d, %d)\n", row, col);
-#endif
+    if (world->currentGenProc[slot] < genProc) return 0;
 
-    if (possibleRabbitMoves->emptyMovements > 0) {
+    EntityInfo child;
 
-        int nextPosition = (genNumber + row + col) % possibleRabbitMoves->emptyMovements;
+    initEntity(&child, species, genNumber);
+    placeEntity(nextWorld, row, col, &child);
 
-        MoveDirection direction = possibleRabbitMoves->emptyDirections[nextPosition];
-        Move *move = getMoveFor(direction);
+    return 1;
+}
 
-        int newRow = row + move->x, newCol = col + move->y;
+/**
+ * Move the animal of world that decided to move into the slot of nextWorld, from its neighbour in direction.
+ * Same as the second half of tickRabbit and tickFox
+ *
+ * @return 1 if it moved into an empty slot (Or won the collision with a rabbit)
+ */
+static int arriveInSlot(int genNumber, InputData *inputData, World *world, World *nextWorld, int row, int col,
+                        MoveDirection direction) {
 
-#ifdef VERBOSE
-        printf("Moving rabbit (%d, %d) with direction %d (Index: %d, Possible: %d) to location %d %d age %d \n", row, col, direction,
-               nextPosition, possibleRabbitMoves->emptyMovements,
-               newRow, newCol, rabbitInfo->currentGen);
-#endif
+    EntityInfo entity;
 
-        WorldSlot *realSlot = &world[PROJECT(inputData->columns, row, col)];
+    getEntity(world, PROJECT(world->columns, row + DIRECTION_MOVES[direction].x, col + DIRECTION_MOVES[direction].y),
+              &entity);
 
-        if (rabbitInfo->currentGen >= inputData->gen_proc_rabbits) {
-            //If the rabbit is old enough to procriate we need to leave a rabbit at that location
+    int fox = entity.slotContent == FOX;
 
-            //Initialize a new rabbit for that position
-            realSlot->entityInfo.rabbitInfo = initRabbitInfo();
-            realSlot->entityInfo.rabbitInfo->genUpdated = genNumber;
-            rabbitInfo->genUpdated = genNumber;
-            rabbitInfo->prevGen = 0;
-            rabbitInfo->currentGen = 0;
+    if (fox) entity.currentGenFood++;
 
-            inputData->entitiesPerRow[row]++;
+    int procriated = entity.currentGenProc >= (fox ? inputData->gen_proc_foxes : inputData->gen_proc_rabbits);
 
-            procriated = 1;
-        } else {
-            realSlot->slotContent = EMPTY;
-            realSlot->entityInfo.rabbitInfo = NULL;
-        }
+    if (procriated) {
+        entity.genUpdated = genNumber & 1;
+        entity.currentGenProc = 0;
+    }
 
-        if (newRow < startRow || newRow > endRow) {
-            //Conflict, we have to access another thread's memory space, create a conflict
-            //And store it in our conflict list
-            initAndAppendConflict(conflictsForThread, newRow < startRow, newRow, newCol, slot);
+    int result = fox ? handleMoveFox(genNumber, &entity, nextWorld, row, col)
+                     : handleMoveRabbit(genNumber, &entity, nextWorld, row, col);
 
-        } else {
-            WorldSlot *newSlot = &world[PROJECT(inputData->columns, newRow, newCol)];
+    if (result == 1 || result == 2) {
+        entity.genUpdated = genNumber & 1;
 
-            movementResult = handleMoveRabbit(rabbitInfo, newSlot);
+        if (!procriated) entity.currentGenProc++;
 
-            if (movementResult == 1) {
-                inputData->entitiesPerRow[newRow]++;
-            }
-        }
-    } else {
-        //No possible movements for the rabbit
-        inputData->entitiesPerRow[row]++;
+        if (result == 2) entity.currentGenFood = 0;
 
+        placeEntity(nextWorld, row, col, &entity);
     }
 
-    //Increment the current after performing the move, but before the conflict resolution, so that
-    //we only generate children in the next generation, but we still have the correct
-    //Number to handle the conflicts
-    if (!procriated) {
-        //Only increment if we did not procriate
-        rabbitInfo->prevGen = rabbitInfo->currentGen;
-        rabbitInfo->genUpdated = genNumber;
-        rabbitInfo->currentGen++;
-    }
+    return result == 1;
+}
 
-    if (!movementResult) {
-        freeRabbitInfo(rabbitInfo);
-    }
+/**
+ * The decisions of the thread for the moves of the species (Each species has its own window, so both phases can
+ * be in progress at once)
+ */
+static inline uint64_t *getThreadDecisions(InputData *inputData, int threadNumber, SlotContent species,
+                                           int wordsPerRow) {
+    size_t window = (size_t) GATHER_WINDOW * DIRECTIONS * wordsPerRow;
+
+    return &inputData->moveDecisions[(2 * (size_t) threadNumber + (species == FOX)) * window];
 }
 
-static void
-performRabbitGeneration(int threadNumber, int genNumber, InputData *inputData, struct ThreadedData *threadedData,
-                        WorldSlot *world, WorldSlot *worldCopy, int startRow, int endRow) {
+/**
+ * Write the words between startWord and endWord of the row of nextWorld with the animals of world that end up in
+ * them, adding the animals to entities (Which the rabbit phase starts over). The moves of the rows above, at and
+ * below it have to be decided already, including the words on each side of the segment
+ */
+static void gatherSegment(int genNumber, InputData *inputData, World *world, World *nextWorld, SlotContent species,
+                          uint64_t *decisions, int row, int startWord, int endWord, int *entities) {
 
-    int storagePaddingTop = startRow > 0 ? 1 : 0;
+    int wordsPerRow = world->occupiedWordsPerRow;
 
-#ifdef VERBOSE
-    printf("End Row: %d, start row: %d, storage padding top %d\n", endRow, startRow, storagePaddingTop);
-#endif
-    int trueRowCount = (endRow - startRow);
+    uint64_t *plane = species == RABBIT ? world->rabbits : world->foxes;
+
+    if (species == RABBIT) {
+        *entities = 0;
+    }
 
-    Conflicts *conflictsForThread;
+    prepareNextWorldSegment(world, nextWorld, row, startWord, endWord, species == RABBIT ? FOX : RABBIT);
 
-    if (threadedData != NULL)
-        conflictsForThread = threadedData->conflictPerThreads[threadNumber];
+    uint64_t *above = row > 0 ? getDecisionRow(decisions, wordsPerRow, row - 1) : NULL,
+            *current = getDecisionRow(decisions, wordsPerRow, row),
+            *below = row + 1 < inputData->rows ? getDecisionRow(decisions, wordsPerRow, row + 1) : NULL;
 
-    //First move the rabbits
+    for (int word = startWord; word <= endWord; word++) {
 
-    struct RabbitMovements *possibleRabbitMoves = initRabbitMovements();
+        uint64_t animals = plane[row * wordsPerRow + word];
 
-    for (int copyRow = 0; copyRow <= trueRowCount; copyRow++) {
-        int row = copyRow + startRow;
-        inputData->entitiesPerRow[row] = 0;
-    }
+        //The slots each neighbour moves into, in the order of ARRIVAL_ORDER
+        uint64_t *east = &current[EAST * wordsPerRow], *west = &current[WEST * wordsPerRow];
 
-    for (int copyRow = 0; copyRow <= trueRowCount; copyRow++) {
-        int row = copyRow + startRow;
+        uint64_t arrivals[DIRECTIONS] = {
+                above != NULL ? above[SOUTH * wordsPerRow + word] : 0,
+                (east[word] << 1) | (word > 0 ? east[word - 1] >> 63 : 0),
+                (west[word] >> 1) | (word < wordsPerRow - 1 ? west[word + 1] << 63 : 0),
+                below != NULL ? below[NORTH * wordsPerRow + word] : 0
+        };
 
-        for (int col = 0; col < inputData->columns; col++) {
+        uint64_t moved = current[NORTH * wordsPerRow + word] | east[word] | current[SOUTH * wordsPerRow + word]
+                         | west[word];
 
-            WorldSlot *slot = &worldCopy[PROJECT(inputData->columns, copyRow + storagePaddingTop, col)];
+        uint64_t slots = animals | arrivals[0] | arrivals[1] | arrivals[2] | arrivals[3];
 
-            if (slot->slotContent == RABBIT) {
+        for (; slots != 0; slots &= slots - 1) {
+            int bit = __builtin_ctzll(slots), col = (word << 6) + bit;
 
-                getPossibleRabbitMovements(copyRow + storagePaddingTop, col, inputData, worldCopy,
-                                           possibleRabbitMoves);
+            if ((animals >> bit) & 1) {
+                *entities += (moved >> bit) & 1 ? leaveSlot(genNumber, inputData, world, nextWorld, row, col)
+                                                : stayInSlot(genNumber, inputData, world, nextWorld, row, col);
 
-                tickRabbit(genNumber, startRow, endRow, row, col, slot,
-                           inputData, world, possibleRabbitMoves, conflictsForThread);
+                continue;
+            }
 
-                //Even though we get passed the struct by value, we have to free it,as there's some arrays
-                //Contained in it
+            for (int arrival = 0; arrival < DIRECTIONS; arrival++) {
+                if ((arrivals[arrival] >> bit) & 1) {
+                    *entities += arriveInSlot(genNumber, inputData, world, nextWorld, row, col,
+                                              ARRIVAL_ORDER[arrival]);
+                }
             }
         }
     }
+}
 
-    freeRabbitMovements(possibleRabbitMoves);
-
-    //Initialize with the conflicts at null because we don't want to access the memory
-    //Until we know it's safe to do so
-    struct ThreadConflictData conflictData = {threadNumber, startRow, endRow, inputData,
-                                              world, threadedData};
-
-    synchronizeThreadAndSolveConflicts(&conflictData);
+/**
+ * gatherSegment, for every word of the row
+ */
+static void gatherRow(int genNumber, InputData *inputData, World *world, World *nextWorld, SlotContent species,
+                      uint64_t *decisions, int row) {
+    gatherSegment(genNumber, inputData, world, nextWorld, species, decisions, row, 0, world->occupiedWordsPerRow - 1,
+                  &inputData->entitiesPerRow[row]);
 }
 
+/**
+ * A phase of the gather engine: the rows of nextWorld between startRow and endRow are written with the animals of
+ * the species in world that end up in them.
+ *
+ * The moves are decided from world alone (Which no thread writes in this phase), including the ones of the rows
+ * just outside ours, which the threads next to us also decide. Each slot then takes in the animals that moved into
+ * it, in the order the other engines would move them, so no thread ever writes outside its rows.
+ */
+static void performGatherPhase(int threadNumber, int genNumber, InputData *inputData, World *world,
+                               World *nextWorld, int startRow, int endRow, SlotContent species) {
 
-static void tickFox(int genNumber, int startRow, int endRow, int row, int col, WorldSlot *slot,
-                    InputData *inputData, WorldSlot *world,
-                    struct FoxMovements *foxMovements, Conflicts *conflictsForThread) {
+    int wordsPerRow = world->occupiedWordsPerRow;
 
-    FoxInfo *foxInfo = slot->entityInfo.foxInfo;
+    uint64_t *decisions = getThreadDecisions(inputData, threadNumber, species, wordsPerRow);
 
-    //If there is no move, the result is positive, as no other animal should try to eat us
-    int foxMovementResult = 1;
+    for (int row = startRow > 0 ? startRow - 1 : 0; row <= startRow; row++) {
+        decideMovesForRow(genNumber, inputData, world, species, row, getDecisionRow(decisions, wordsPerRow, row));
+    }
 
-    //Since we store the row that's above, we have to compensate with the storagePadding
+    for (int row = startRow; row <= endRow; row++) {
 
-    //Increment the gen food so the fox dies before moving and after not finding a rabbit to eat
-    foxInfo->currentGenFood++;
+        if (row + 1 < inputData->rows) {
+            decideMovesForRow(genNumber, inputData, world, species, row + 1,
+                              getDecisionRow(decisions, wordsPerRow, row + 1));
+        }
 
-#ifdef VERBOSE
-    printf("Checking fox %p (%d %d) food %d\n", foxInfo, row, col, foxInfo->currentGenFood);
-#endif
+        gatherRow(genNumber, inputData, world, nextWorld, species, decisions, row);
+    }
+}
 
-    if (foxMovements->rabbitMovements <= 0) {
-        if (foxInfo->currentGenFood >= inputData->gen_food_foxes) {
-            //If the fox gen food reaches the limit, kill it before it moves.
-            WorldSlot *realSlot = &world[PROJECT(inputData->columns, row, col)];
+/*
+ * The amount of rows taken at a time in the stealing engine. Every chunk decides the moves of the rows just outside
+ * of it again, so smaller chunks balance better but do more work
+ */
+#define STEAL_CHUNK_ROWS 8
 
-            realSlot->slotContent = EMPTY;
+/**
+ * A phase of the stealing engine: performGatherPhase, a chunk of rows at a time. The thread starts with the chunks
+ * of its own rows (Given by the balance of the last generation), and then steals the chunks other threads haven't
+ * gotten to yet.
+ *
+ * The gather engine never writes outside the rows it's given, so there are no conflicts at the edges of the chunks
+ */
+static void performStealingPhase(int threadNumber, int genNumber, InputData *inputData,
+                                 struct ThreadedData *threadedData, World *world, World *nextWorld,
+                                 ThreadRowData *ourData, SlotContent species) {
 
-            realSlot->entityInfo.foxInfo = NULL;
+    int startRow, endRow;
 
-#ifdef VERBOSE
-            printf("Fox %p on %d %d Starved to death\n", foxInfo, row, col);
-#endif
+    fillRowDeque(threadNumber, ourData->startRow, ourData->endRow, threadedData);
 
-            freeFoxInfo(foxInfo);
+    while (takeRowChunk(threadNumber, STEAL_CHUNK_ROWS, &startRow, &endRow, threadedData)) {
+        performGatherPhase(threadNumber, genNumber, inputData, world, nextWorld, startRow, endRow, species);
+    }
 
-            return;
-        }
+    while (stealRowChunk(threadNumber, inputData->threads, STEAL_CHUNK_ROWS, &startRow, &endRow, threadedData)) {
+        performGatherPhase(threadNumber, genNumber, inputData, world, nextWorld, startRow, endRow, species);
     }
+}
 
-    int nextPosition;
+/**
+ * A phase of the tiled engine: performGatherPhase, on the tile of the thread instead of its rows.
+ *
+ * The moves of the words just outside the tile (On every side) are decided from world, like the rows outside of
+ * the strips of the gather engine. The entities are counted for each block of the rows, as the blocks of a row
+ * can belong to different tiles
+ */
+static void performTiledPhase(int threadNumber, int genNumber, InputData *inputData, World *world,
+                              World *nextWorld, ThreadRowData *tile, SlotContent species) {
 
-    MoveDirection direction;
-    int procriated = 0;
+    int wordsPerRow = world->occupiedWordsPerRow;
 
-    //Can only breed a fox when we are capable of moving
-    if ((foxMovements->emptyMovements > 0 || foxMovements->rabbitMovements > 0)) {
-        WorldSlot *realSlot = &world[PROJECT(inputData->columns, row, col)];
+    uint64_t *decisions = getThreadDecisions(inputData, threadNumber, species, wordsPerRow);
 
-        if (foxInfo->currentGenProc >= inputData->gen_proc_foxes) {
-            realSlot->slotContent = FOX;
+    int startRow = tile->startRow, endRow = tile->endRow,
+            firstDecided = tile->startWord > 0 ? tile->startWord - 1 : 0,
+            lastDecided = tile->endWord < wordsPerRow - 1 ? tile->endWord + 1 : tile->endWord;
 
-            realSlot->entityInfo.foxInfo = initFoxInfo();
-            realSlot->entityInfo.foxInfo->genUpdated = genNumber;
+    for (int row = startRow > 0 ? startRow - 1 : 0; row <= startRow; row++) {
+        decideMovesForSegment(genNumber, inputData, world, species, row, firstDecided, lastDecided,
+                              getDecisionRow(decisions, wordsPerRow, row));
+    }
 
-            inputData->entitiesPerRow[row]++;
+    for (int row = startRow; row <= endRow; row++) {
 
-            foxInfo->genUpdated = genNumber;
-            foxInfo->prevGenProc = foxInfo->currentGenProc;
-            foxInfo->currentGenProc = 0;
-            procriated = 1;
-        } else {
-            //Clear the slot
-            realSlot->slotContent = EMPTY;
+        if (row + 1 < inputData->rows) {
+            decideMovesForSegment(genNumber, inputData, world, species, row + 1, firstDecided, lastDecided,
+                                  getDecisionRow(decisions, wordsPerRow, row + 1));
+        }
+
+        for (int word = tile->startWord; word <= tile->endWord; word += TILE_BLOCK_WORDS) {
+            int lastWord = word + TILE_BLOCK_WORDS - 1 < tile->endWord ? word + TILE_BLOCK_WORDS - 1 : tile->endWord;
 
-            realSlot->entityInfo.foxInfo = NULL;
+            gatherSegment(genNumber, inputData, world, nextWorld, species, decisions, row, word, lastWord,
+                          &inputData->entitiesPerBlock[row * inputData->columnBlocks + word / TILE_BLOCK_WORDS]);
         }
     }
+}
 
-    if (foxMovements->rabbitMovements > 0) {
-        nextPosition = (genNumber + row + col) % foxMovements->rabbitMovements;
+/*
+ * The fox phase of a row reads the rabbits of the 2 rows on each side of it (The moves of the foxes next to it
+ * depend on their neighbours), and it overwrites the row of world the rabbit phase reads, which the rabbit phase
+ * is done with once it has moved on to the next row. So the fox phase of a row can run as soon as the rabbit phase
+ * is FUSED_LAG rows ahead of it
+ */
+#define FUSED_LAG 2
 
-        direction = foxMovements->rabbitDirections[nextPosition];
-    } else if (foxMovements->emptyMovements > 0) {
-        nextPosition = (genNumber + row + col) % foxMovements->emptyMovements;
+/**
+ * The rows between startRow and endRow that the fox phase can run on in the sweep: all of them, except for the
+ * borderRows rows at each end that are next to the rows of another thread
+ */
+static inline void getFusedFoxRows(InputData *inputData, int startRow, int endRow, int borderRows,
+                                   int *foxStart, int *foxEnd) {
+    *foxStart = startRow > 0 ? startRow + borderRows : startRow;
+    *foxEnd = endRow < inputData->rows - 1 ? endRow - borderRows : endRow;
+}
 
-        direction = foxMovements->emptyDirections[nextPosition];
-    }
+/**
+ * The fused engine runs both phases in a single sweep over the rows between startRow and endRow: after the rabbits
+ * of a row are written into nextWorld, the foxes of the row FUSED_LAG rows above it are written back into world.
+ * The rows of each phase only have to be read once while they are still in the cache, instead of twice a generation.
+ *
+ * The fox phase of the first and last borderRows rows is left out (See performFusedBorders), as it reads the rows
+ * of the threads next to ours, and writes rows they read in their rabbit phase.
+ */
+static void performFusedSweep(int threadNumber, int genNumber, InputData *inputData, World *world,
+                              World *nextWorld, int startRow, int endRow, int borderRows) {
 
-    if (foxMovements->rabbitMovements > 0 || foxMovements->emptyMovements > 0) {
-        Move *move = getMoveFor(direction);
+    int wordsPerRow = world->occupiedWordsPerRow;
 
-        int newRow = row + move->x, newCol = col + move->y;
+    uint64_t *rabbitDecisions = getThreadDecisions(inputData, threadNumber, RABBIT, wordsPerRow),
+            *foxDecisions = getThreadDecisions(inputData, threadNumber, FOX, wordsPerRow);
 
-        if (newRow < startRow || newRow > endRow) {
-            //Conflict, we have to access another thread's memory space, create a conflict
-            //And store it in our conflict list
-            initAndAppendConflict(conflictsForThread, newRow < startRow, newRow, newCol, slot);
-        } else {
-            WorldSlot *newSlot = &world[PROJECT(inputData->columns, newRow, newCol)];
+    int foxStart, foxEnd;
 
-            foxMovementResult = handleMoveFox(foxInfo, newSlot);
-            //We only increment the rows under our control, to avoid concurrency issues
-            if (foxMovementResult == 1) {
-                inputData->entitiesPerRow[newRow]++;
+    getFusedFoxRows(inputData, startRow, endRow, borderRows, &foxStart, &foxEnd);
+
+    for (int row = startRow > 0 ? startRow - 1 : 0; row <= startRow; row++) {
+        decideMovesForRow(genNumber, inputData, world, RABBIT, row, getDecisionRow(rabbitDecisions, wordsPerRow, row));
+    }
+
+    for (int row = startRow; row <= endRow + FUSED_LAG; row++) {
+
+        if (row <= endRow) {
+            if (row + 1 < inputData->rows) {
+                decideMovesForRow(genNumber, inputData, world, RABBIT, row + 1,
+                                  getDecisionRow(rabbitDecisions, wordsPerRow, row + 1));
             }
+
+            gatherRow(genNumber, inputData, world, nextWorld, RABBIT, rabbitDecisions, row);
         }
-    } else {
-        inputData->entitiesPerRow[row]++;
-#ifdef VERBOSE
-        printf("FOX at %d %d has no possible movements\n", row, col);
-#endif
-    }
 
-    if (!procriated) {
-        foxInfo->genUpdated = genNumber;
-        foxInfo->prevGenProc = foxInfo->currentGenProc;
-    }
+        int foxRow = row - FUSED_LAG;
 
-    if (foxMovementResult == 1 || foxMovementResult == 2) {
+        if (foxRow < foxStart || foxRow > foxEnd) continue;
 
-        if (!procriated) {
-            //Only increment the procriated when the fox did not replicate
-            //(Or else it would start with 1 extra gen)
-            foxInfo->currentGenProc++;
+        if (foxRow == foxStart) {
+            for (int decided = foxRow > 0 ? foxRow - 1 : 0; decided <= foxRow; decided++) {
+                decideMovesForRow(genNumber, inputData, nextWorld, FOX, decided,
+                                  getDecisionRow(foxDecisions, wordsPerRow, decided));
+            }
         }
 
-        //If the fox eats a rabbit, reset it's current gen food
-        if (foxMovementResult == 2) {
-            foxInfo->currentGenFood = 0;
+        if (foxRow + 1 < inputData->rows) {
+            decideMovesForRow(genNumber, inputData, nextWorld, FOX, foxRow + 1,
+                              getDecisionRow(foxDecisions, wordsPerRow, foxRow + 1));
         }
 
-    } else if (foxMovementResult == 0) {
-        //If the move failed kill the fox
-        freeFoxInfo(foxInfo);
+        gatherRow(genNumber, inputData, nextWorld, world, FOX, foxDecisions, foxRow);
     }
 }
 
-static void
-performFoxGeneration(int threadNumber, int genNumber, InputData *inputData, struct ThreadedData *threadedData,
-                     WorldSlot *world, WorldSlot *worldCopy, int startRow, int endRow) {
+/**
+ * The fox phase of the rows left out by performFusedSweep, once every thread is done with its sweep
+ */
+static void performFusedBorders(int threadNumber, int genNumber, InputData *inputData, World *world,
+                                World *nextWorld, int startRow, int endRow, int borderRows) {
 
-    int storagePaddingTop = startRow > 0 ? 1 : 0;
+    int foxStart, foxEnd;
 
-    int trueRowCount = endRow - startRow;
+    getFusedFoxRows(inputData, startRow, endRow, borderRows, &foxStart, &foxEnd);
 
-    Conflicts *conflictsForThread;
-    if (threadedData != NULL)
-        conflictsForThread = threadedData->conflictPerThreads[threadNumber];
+    if (foxStart > foxEnd) {
+        performGatherPhase(threadNumber, genNumber, inputData, nextWorld, world, startRow, endRow, FOX);
 
-    struct FoxMovements *foxMovements = initFoxMovements();
+        return;
+    }
 
-    for (int copyRow = 0; copyRow <= trueRowCount; copyRow++) {
-        for (int col = 0; col < inputData->columns; col++) {
+    if (foxStart > startRow) {
+        performGatherPhase(threadNumber, genNumber, inputData, nextWorld, world, startRow, foxStart - 1, FOX);
+    }
 
-            int row = copyRow + startRow;
+    if (foxEnd < endRow) {
+        performGatherPhase(threadNumber, genNumber, inputData, nextWorld, world, foxEnd + 1, endRow, FOX);
+    }
+}
 
-            WorldSlot *slot = &worldCopy[PROJECT(inputData->columns, copyRow + storagePaddingTop, col)];
+void performSequentialGeneration(int genNumber, InputData *inputData, World *world, World *nextWorld) {
 
-            if (slot->slotContent == FOX) {
+    int startRow = 0, endRow = inputData->rows - 1;
 
-                getPossibleFoxMovements(copyRow + storagePaddingTop, col, inputData,
-                                        worldCopy, foxMovements);
+    if (inputData->engine == BITBOARD_ENGINE || inputData->engine == ATOMIC_ENGINE) {
+        //There are no other threads, so the atomic engine has no border rows
+        performRabbitGenerationBitboard(0, genNumber, inputData, NULL, world, nextWorld, startRow, endRow);
 
-                tickFox(genNumber, startRow, endRow, row, col, slot,
-                        inputData, world, foxMovements, conflictsForThread);
+        performFoxGenerationBitboard(0, genNumber, inputData, NULL, nextWorld, world, startRow, endRow);
+    } else if (inputData->engine == GATHER_ENGINE || inputData->engine == TILED_ENGINE ||
+               inputData->engine == STEALING_ENGINE) {
+        //A single thread has a single tile, that covers the whole world (And nothing to steal from)
+        performGatherPhase(0, genNumber, inputData, world, nextWorld, startRow, endRow, RABBIT);
 
-            }
-        }
+        performGatherPhase(0, genNumber, inputData, nextWorld, world, startRow, endRow, FOX);
+    } else if (inputData->engine == FUSED_ENGINE) {
+        //There are no other threads, so there are no borders to leave out
+        performFusedSweep(0, genNumber, inputData, world, nextWorld, startRow, endRow, 0);
+    } else {
+        performRabbitGeneration(0, genNumber, inputData, NULL, world, nextWorld, startRow, endRow);
+
+        performFoxGeneration(0, genNumber, inputData, NULL, nextWorld, world, startRow, endRow);
     }
 
-    freeFoxMovements(foxMovements);
+}
 
-    struct ThreadConflictData conflictData = {threadNumber, startRow, endRow, inputData,
-                                              world, threadedData};
+void performGeneration(int threadNumber, int genNumber,
+                       InputData *inputData, struct ThreadedData *threadedData, World *world, World *nextWorld,
+                       ThreadRowData *threadRowData) {
+    ThreadRowData *ourData = &threadRowData[threadNumber];
 
-    synchronizeThreadAndSolveConflicts(&conflictData);
-}
+    //printf("Thread %d has start row %d and end row %d\n", threadNumber, ourData->startRow, ourData->endRow);
 
-void performSequentialGeneration(int genNumber, InputData *inputData, WorldSlot *world) {
+    int startRow = ourData->startRow,
+            endRow = ourData->endRow;
 
-    int startRow = 0, endRow = inputData->rows - 1;
+    //No thread writes to the buffer that is being read in a phase, so the rows that surround ours can be read
+    //directly from it, without making a copy
+    clearConflictsForThread(threadNumber, threadedData);
 
-    int copyStartRow = startRow, copyEndRow = endRow;
+    if (inputData->engine == FUSED_ENGINE) {
+        int borderRows = FUSED_LAG;
 
-    int rowCount = (copyEndRow - copyStartRow) + 1;
+        performFusedSweep(threadNumber, genNumber, inputData, world, nextWorld, startRow, endRow, borderRows);
 
-    /**
- * A copy of our area of the tray. This copy will not be modified
- */
-    WorldSlot *worldCopy = malloc(sizeof(WorldSlot) * rowCount * inputData->columns);
+        //Wait for the threads next to ours to be done with the rows around the borders of our rows
+        waitAtTreeBarrier(&threadedData->barrier, threadNumber);
 
-#ifdef VERBOSE
-    printf("Doing copy of world Row: %d to %d (Initial: %d %d, %d)\n", copyStartRow, copyEndRow, startRow, endRow,
-           inputData->rows);
-#endif
+        performFusedBorders(threadNumber, genNumber, inputData, world, nextWorld, startRow, endRow, borderRows);
 
-    makeCopyOfPartOfWorld(0, inputData, NULL, world, worldCopy, copyStartRow, copyEndRow);
+        calculateAccumulatedEntitiesForThread(threadNumber, inputData, threadRowData, threadedData);
 
-#ifdef VERBOSE
-    printf("Done copy on thread %d\n", threadNumber);
-#endif
+        return;
+    }
 
-    performRabbitGeneration(0, genNumber, inputData, NULL, world, worldCopy, startRow, endRow);
+    if (inputData->engine == GATHER_ENGINE) {
+        int phase = genNumber * 2;
 
-    makeCopyOfPartOfWorld(0, inputData, NULL, world, worldCopy, copyStartRow, copyEndRow);
+        //A phase reads the rows of the threads next to ours that they wrote in their last phase, and writes the
+        //buffer they read in it, so we only have to wait for them. A thread can be ahead of the threads further away
+        waitForNeighbourPhases(threadNumber, phase, GATHER_REACH, inputData, threadRowData, threadedData);
 
-    performFoxGeneration(0, genNumber, inputData, NULL, world, worldCopy, startRow, endRow);
+        performGatherPhase(threadNumber, genNumber, inputData, world, nextWorld, startRow, endRow, RABBIT);
 
-    free(worldCopy);
+        finishPhase(threadNumber, threadedData);
 
-}
+        waitForNeighbourPhases(threadNumber, phase + 1, GATHER_REACH, inputData, threadRowData, threadedData);
 
-void performGeneration(int threadNumber, int genNumber,
-                       InputData *inputData, struct ThreadedData *threadedData, WorldSlot *world,
-                       ThreadRowData *threadRowData) {
-    ThreadRowData *ourData = &threadRowData[threadNumber];
+        performGatherPhase(threadNumber, genNumber, inputData, nextWorld, world, startRow, endRow, FOX);
 
-    //printf("Thread %d has start row %d and end row %d\n", threadNumber, ourData->startRow, ourData->endRow);
+        finishPhase(threadNumber, threadedData);
 
-    int startRow = ourData->startRow,
-            endRow = ourData->endRow;
+        //The entities are also counted at the end, for the results
+        if ((genNumber + 1) % REBALANCE_GENERATIONS == 0 || genNumber == inputData->n_gen - 1) {
+            calculateAccumulatedEntitiesForThread(threadNumber, inputData, threadRowData, threadedData);
+        }
 
-    int copyStartRow = startRow > 0 ? startRow - 1 : startRow,
-            copyEndRow = endRow < (inputData->rows - 1) ? endRow + 1 : endRow;
+        return;
+    }
 
-    int rowCount = ((copyEndRow - copyStartRow) + 1);
+    if (inputData->engine == TILED_ENGINE) {
+        performTiledPhase(threadNumber, genNumber, inputData, world, nextWorld, ourData, RABBIT);
 
-    /**
-     * A copy of our area of the tray. This copy will not be modified
-     */
-    WorldSlot worldCopy[rowCount * inputData->columns];
+        //Wait for every tile to be written into nextWorld, as the foxes read the tiles around ours
+        waitAtTreeBarrier(&threadedData->barrier, threadNumber);
 
-#ifdef VERBOSE
-    printf("Doing copy of world Row: %d to %d (Initial: %d %d, %d)\n", copyStartRow, copyEndRow, startRow, endRow,
-           inputData->rows);
-#endif
+        performTiledPhase(threadNumber, genNumber, inputData, nextWorld, world, ourData, FOX);
 
-    makeCopyOfPartOfWorld(threadNumber, inputData, threadedData, world, worldCopy, copyStartRow, copyEndRow);
+        calculateTilesForThread(threadNumber, inputData, threadRowData, threadedData);
 
-#ifdef VERBOSE
-    printf("Done copy on thread %d\n", threadNumber);
-#endif
+        return;
+    }
 
-    clearConflictsForThread(threadNumber, threadedData);
+    if (inputData->engine == STEALING_ENGINE) {
+        performStealingPhase(threadNumber, genNumber, inputData, threadedData, world, nextWorld, ourData, RABBIT);
+
+        //Wait for every chunk to be written into nextWorld, wherever it was stolen to
+        waitAtTreeBarrier(&threadedData->barrier, threadNumber);
+
+        performStealingPhase(threadNumber, genNumber, inputData, threadedData, nextWorld, world, ourData, FOX);
+
+        //Our rows may still be counted by the threads that stole them
+        waitAtTreeBarrier(&threadedData->barrier, threadNumber);
+
+        calculateAccumulatedEntitiesForThread(threadNumber, inputData, threadRowData, threadedData);
 
-    performRabbitGeneration(threadNumber, genNumber, inputData, threadedData, world, worldCopy, startRow, endRow);
+        return;
+    }
 
-    pthread_barrier_wait(&threadedData->barrier);
+    if (inputData->engine == BITBOARD_ENGINE) {
+        performRabbitGenerationBitboard(threadNumber, genNumber, inputData, threadedData, world, nextWorld,
+                                        startRow, endRow);
+    } else if (inputData->engine == ATOMIC_ENGINE) {
+        performRabbitGenerationAtomic(genNumber, inputData, world, nextWorld, startRow, endRow);
+    } else {
+        performRabbitGeneration(threadNumber, genNumber, inputData, threadedData, world, nextWorld,
+                                startRow, endRow);
+    }
 
-    makeCopyOfPartOfWorld(threadNumber, inputData, threadedData, world, worldCopy, copyStartRow, copyEndRow);
+    //Wait for every thread to finish writing the rabbits (And their conflicts) into nextWorld
+    waitAtTreeBarrier(&threadedData->barrier, threadNumber);
 
     clearConflictsForThread(threadNumber, threadedData);
 
-    performFoxGeneration(threadNumber, genNumber, inputData, threadedData, world, worldCopy, startRow, endRow);
+    //Every thread is done claiming the slots of our border rows
+    settleBorderRows(genNumber, inputData, nextWorld, startRow, endRow);
+
+    if (inputData->engine == BITBOARD_ENGINE) {
+        performFoxGenerationBitboard(threadNumber, genNumber, inputData, threadedData, nextWorld, world,
+                                     startRow, endRow);
+    } else if (inputData->engine == ATOMIC_ENGINE) {
+        performFoxGenerationAtomic(genNumber, inputData, nextWorld, world, startRow, endRow);
+    } else {
+        performFoxGeneration(threadNumber, genNumber, inputData, threadedData, nextWorld, world,
+                             startRow, endRow);
+    }
+
+    if (inputData->engine == ATOMIC_ENGINE) {
+        //The entities that moved into our rows have to be written (And counted) before the threads are balanced
+        waitAtTreeBarrier(&threadedData->barrier, threadNumber);
+
+        settleBorderRows(genNumber, inputData, world, startRow, endRow);
+    }
 
     calculateAccumulatedEntitiesForThread(threadNumber, inputData, threadRowData, threadedData);
 }
@@ -736,7 +2461,7 @@ void handleConflicts(struct ThreadConflictData *threadConflictData, int conflict
     printf("Thread %d called handle conflicts with size %d\n", threadConflictData->threadNum, conflictCount);
 #endif
 
-    WorldSlot *world = threadConflictData->world;
+    World *world = threadConflictData->world;
 
     /*
      * Go through all the conflicts
@@ -757,28 +2482,23 @@ void handleConflicts(struct ThreadConflictData *threadConflictData, int conflict
             continue;
         }
 
-        WorldSlot *currentEntityInSlot =
-                &world[PROJECT(threadConflictData->inputData->columns, row, column)];
+        int currentEntityInSlot = PROJECT(threadConflictData->inputData->columns, row, column);
 
         //Both entities are the same, so we have to follow the rules for eating rabbits.
-        if (conflict->slotContent == RABBIT) {
-
-            movementResult = handleMoveRabbit((RabbitInfo *) conflict->data, currentEntityInSlot);
+        if (conflict->entity.slotContent == RABBIT) {
 
-            if (movementResult == 0) {
-                freeRabbitInfo(conflict->data);
-            }
+            movementResult = handleMoveRabbit(threadConflictData->genNumber, &conflict->entity,
+                                              world, row, column);
 
-        } else if (conflict->slotContent == FOX) {
+        } else if (conflict->entity.slotContent == FOX) {
 
-            movementResult = handleMoveFox(conflict->data, currentEntityInSlot);
+            movementResult = handleMoveFox(threadConflictData->genNumber, &conflict->entity, world,
+                                           row, column);
 
             if (movementResult == 2) {
                 //This happens after the gen food has been incremented, so if we set it to 0 here
                 //It should produce the desired output
-                ((FoxInfo *) conflict->data)->currentGenFood = 0;
-            } else if (movementResult == 0) {
-                freeFoxInfo(conflict->data);
+                world->currentGenFood[currentEntityInSlot] = 0;
             }
 
         }
@@ -786,6 +2506,11 @@ void handleConflicts(struct ThreadConflictData *threadConflictData, int conflict
         if (movementResult == 1) {
             threadConflictData->inputData->entitiesPerRow[row]++;
         }
+
+        if (movementResult == 1 || movementResult == 2) {
+            appendEntity(threadConflictData->entities,
+                         ENTITY_KEY(threadConflictData->inputData->columns, row, column));
+        }
     }
 }
 
@@ -796,94 +2521,43 @@ void handleConflicts(struct ThreadConflictData *threadConflictData, int conflict
  * Returns 1 if the fox moves without dying, 2 if the fox eats a rabbit in the process,
  * 0 if the fox dies, -1 is err
  */
-static int handleMoveFox(FoxInfo *foxInfo, WorldSlot *newSlot) {
-    if (newSlot->slotContent == FOX) {
-
-        int foxInfoAge, newSlotAge;
-
-        if (foxInfo->genUpdated > newSlot->entityInfo.rabbitInfo->genUpdated) {
-            foxInfoAge = foxInfo->currentGenProc;
-            newSlotAge = newSlot->entityInfo.foxInfo->currentGenProc + 1;
-        } else if (foxInfo->genUpdated < newSlot->entityInfo.rabbitInfo->genUpdated) {
-            foxInfoAge = foxInfo->currentGenProc + 1;
-            newSlotAge = newSlot->entityInfo.foxInfo->currentGenProc;
-        } else {
-            foxInfoAge = foxInfo->currentGenProc;
-            newSlotAge = newSlot->entityInfo.rabbitInfo->currentGen;
-        }
-
-#ifdef VERBOSE
-        printf("Fox conflict with fox %p, current fox in slot is %p\n", foxInfo, newSlot->entityInfo.foxInfo);
-#endif
-
-        if (foxInfoAge > newSlotAge) {
-
-#ifdef VERBOSE
-            printf("Fox jumping in %p has larger gen proc (%d vs %d)\n", foxInfo, foxInfo->currentGenProc,
-                   newSlot->entityInfo.foxInfo->currentGenProc);
-#endif
+static int handleMoveFox(int genNumber, EntityInfo *fox, World *world, int newRow, int newCol) {
+    int newSlot = PROJECT(world->columns, newRow, newCol);
 
-            freeFoxInfo(newSlot->entityInfo.foxInfo);
+    uint8_t slotContent = world->slotContent[newSlot];
 
-            newSlot->entityInfo.foxInfo = foxInfo;
+    if (slotContent == FOX) {
 
-            return 1;
+        EntityInfo slotEntity;
 
-        } else if (foxInfoAge == newSlotAge) {
-            //Sort by currentGenFood (The one that has eaten the latest wins)
-            if (foxInfo->currentGenFood >= newSlot->entityInfo.foxInfo->currentGenFood) {
+        getEntity(world, newSlot, &slotEntity);
 
-#ifdef VERBOSE
-                printf("Fox %p has been killed by gen food (FoxInfo: %d vs %d)\n", foxInfo,
-                       foxInfo->currentGenFood, newSlot->entityInfo.foxInfo->currentGenFood);
-#endif
-
-                //Avoid doing any memory changes, kill the fox that is moving when they are the same age in everything
-
-                return 0;
-            } else {
+        int survives = survivesCollision(genNumber, fox, &slotEntity, 1);
 
 #ifdef VERBOSE
-                printf("Fox %p has been killed by gen food (FoxInfo: %d vs %d)\n", newSlot->entityInfo.foxInfo,
-                       foxInfo->currentGenFood, newSlot->entityInfo.foxInfo->currentGenFood);
+        printf("Two foxes collided, moving fox survives: %d (Food %d vs %d)\n", survives,
+               fox->currentGenFood, slotEntity.currentGenFood);
 #endif
 
-                freeFoxInfo(newSlot->entityInfo.foxInfo);
-
-                newSlot->entityInfo.foxInfo = foxInfo;
-
-                return 1;
-            }
-        } else {
-
-#ifdef VERBOSE
-            printf("Fox already there %p has larger gen proc (%d vs %d)\n", newSlot->entityInfo.foxInfo,
-                   foxInfoAge,
-                   newSlotAge);
-#endif
+        //The slot is written either way (With the fox that was already there if the moving one dies),
+        //so the survivor is picked without a branch
+        placeEntity(world, newRow, newCol, survives ? fox : &slotEntity);
 
-            //Kill the fox that was moving
-            return 0;
-        }
+        return survives;
 
-    } else if (newSlot->slotContent == RABBIT) {
-        //Fox moves to rabbit slot
-        newSlot->slotContent = FOX;
+    } else if (slotContent == RABBIT) {
+        //Fox moves to rabbit slot, killing the rabbit
 
 #ifdef VERBOSE
-        printf("Fox %p Killed Rabbit %p\n", foxInfo, newSlot->entityInfo.rabbitInfo);
+        printf("Fox killed rabbit\n");
 #endif
-        //Kills the rabbit
-        freeRabbitInfo(newSlot->entityInfo.rabbitInfo);
 
-        newSlot->entityInfo.foxInfo = foxInfo;
+        placeEntity(world, newRow, newCol, fox);
 
         return 2;
-    } else if (newSlot->slotContent == EMPTY) {
-
-        newSlot->slotContent = FOX;
+    } else if (slotContent == EMPTY) {
 
-        newSlot->entityInfo.foxInfo = foxInfo;
+        placeEntity(world, newRow, newCol, fox);
 
         return 1;
     } else {
@@ -894,71 +2568,57 @@ static int handleMoveFox(FoxInfo *foxInfo, WorldSlot *newSlot) {
 }
 
 /**
- * Moves the rabbit rabbitInfo into the slot newSlot
+ * Moves the rabbit into the slot newSlot
  *
  * The previous slot must be cleared by you
  *
  * Returns 0 if the rabbit died in the move, 1 if not
  *
- * @param rabbitInfo
+ * @param genNumber
+ * @param rabbit
+ * @param world
  * @param newSlot
  */
-static int handleMoveRabbit(RabbitInfo *rabbitInfo, WorldSlot *newSlot) {
+static int handleMoveRabbit(int genNumber, EntityInfo *rabbit, World *world, int newRow, int newCol) {
+    int newSlot = PROJECT(world->columns, newRow, newCol);
 
-    if (newSlot->slotContent == RABBIT) {
+    uint8_t slotContent = world->slotContent[newSlot];
+
+    if (slotContent == RABBIT) {
 
         //There's already a rabbit in that cell, choose the rabbit that has the oldest proc_age
+        //(If they have the same age, the rabbit that was moving dies)
 
-        int rabbitInfoAge, newSlotAge;
+        EntityInfo slotEntity;
 
-        if (rabbitInfo->genUpdated > newSlot->entityInfo.rabbitInfo->genUpdated) {
-            rabbitInfoAge = rabbitInfo->currentGen;
-            newSlotAge = newSlot->entityInfo.rabbitInfo->currentGen + 1;
-        } else if (rabbitInfo->genUpdated < newSlot->entityInfo.rabbitInfo->genUpdated) {
-            rabbitInfoAge = rabbitInfo->currentGen + 1;
-            newSlotAge = newSlot->entityInfo.rabbitInfo->currentGen;
-        } else {
-            rabbitInfoAge = rabbitInfo->currentGen;
-            newSlotAge = newSlot->entityInfo.rabbitInfo->currentGen;
-        }
+        getEntity(world, newSlot, &slotEntity);
+
+        int survives = survivesCollision(genNumber, rabbit, &slotEntity, 0);
 
 #ifdef VERBOSE
-        printf("Two rabbits collided, rabbitInfo: %p vs newSlot: %p Age: %d vs %d (%d %d %d, %d %d %d)\n", rabbitInfo,
-               newSlot->entityInfo.rabbitInfo,
-               rabbitInfoAge, newSlotAge, rabbitInfo->currentGen, rabbitInfo->genUpdated, rabbitInfo->prevGen,
-               newSlot->entityInfo.rabbitInfo->currentGen,
-               newSlot->entityInfo.rabbitInfo->genUpdated,
-               newSlot->entityInfo.rabbitInfo->prevGen);
+        printf("Two rabbits collided, moving rabbit survives: %d\n", survives);
 #endif
 
-        if (rabbitInfoAge > newSlotAge) {
-            freeRabbitInfo(newSlot->entityInfo.rabbitInfo);
+        placeEntity(world, newRow, newCol, survives ? rabbit : &slotEntity);
 
-            newSlot->entityInfo.rabbitInfo = rabbitInfo;
-
-            return 1;
-        } else {
-            //If they have the same age, avoid doing any movement
-            return 0;
-        }
+        return survives;
 
-    } else if (newSlot->slotContent == EMPTY) {
+    } else if (slotContent == EMPTY) {
 
-        newSlot->slotContent = RABBIT;
-        newSlot->entityInfo.rabbitInfo = rabbitInfo;
+        placeEntity(world, newRow, newCol, rabbit);
 
         return 1;
     } else {
 
         //Shouldn't
 
-        fprintf(stdout, "TRIED MOVING RABBIT TO %d\n", newSlot->slotContent);
+        fprintf(stdout, "TRIED MOVING RABBIT TO %d\n", slotContent);
     }
 
     return -1;
 }
 
-void printPrettyAllGen(FILE *outputFile, InputData *inputData, WorldSlot *world) {
+void printPrettyAllGen(FILE *outputFile, InputData *inputData, World *world) {
 
     for (int col = -1; col <= inputData->columns; col++) {
         fprintf(outputFile, "-");
@@ -993,9 +2653,9 @@ void printPrettyAllGen(FILE *outputFile, InputData *inputData, WorldSlot *world)
 
             for (int col = 0; col < inputData->columns; col++) {
 
-                WorldSlot *slot = &world[PROJECT(inputData->columns, row, col)];
+                int slot = PROJECT(inputData->columns, row, col);
 
-                switch (slot->slotContent) {
+                switch (world->slotContent[slot]) {
 
                     case ROCK:
                         fprintf(outputFile, "*");
@@ -1004,13 +2664,13 @@ void printPrettyAllGen(FILE *outputFile, InputData *inputData, WorldSlot *world)
                         if (i == 0)
                             fprintf(outputFile, "F");
                         else if (i == 1)
-                            fprintf(outputFile, "%d", slot->entityInfo.foxInfo->currentGenProc);
+                            fprintf(outputFile, "%u", world->currentGenProc[slot]);
                         else if (i == 2)
-                            fprintf(outputFile, "%d", slot->entityInfo.foxInfo->currentGenFood);
+                            fprintf(outputFile, "%d", world->currentGenFood[slot]);
                         break;
                     case RABBIT:
                         if (i == 1)
-                            fprintf(outputFile, "%d", slot->entityInfo.rabbitInfo->currentGen);
+                            fprintf(outputFile, "%u", world->currentGenProc[slot]);
                         else
                             fprintf(outputFile, "R");
                         break;
@@ -1047,7 +2707,7 @@ void printPrettyAllGen(FILE *outputFile, InputData *inputData, WorldSlot *world)
     fprintf(outputFile, "\n");
 }
 
-void printResults(FILE *outputFile, InputData *inputData, WorldSlot *worldSlot) {
+void printResults(FILE *outputFile, InputData *inputData, World *world) {
 
     //TODO: Complete the entity count
     fprintf(outputFile, "%d %d %d %d %d %d %d\n", inputData->gen_proc_rabbits, inputData->gen_proc_foxes,
@@ -1055,13 +2715,13 @@ void printResults(FILE *outputFile, InputData *inputData, WorldSlot *worldSlot)
             0, inputData->rows, inputData->columns, inputData->entitiesAccumulatedPerRow[inputData->rows - 1]);
 
     for (int row = 0; row < inputData->rows; row++) {
-        for (int col = 0; col < inputData->columns; col++) {
+        for (int col = nextOccupiedColumn(world, row, 0); col >= 0; col = nextOccupiedColumn(world, row, col + 1)) {
 
-            WorldSlot *slot = &worldSlot[PROJECT(inputData->columns, row, col)];
+            uint8_t slotContent = world->slotContent[PROJECT(inputData->columns, row, col)];
 
-            if (slot->slotContent != EMPTY) {
+            if (slotContent != EMPTY) {
 
-                switch (slot->slotContent) {
+                switch (slotContent) {
                     case RABBIT:
                         fprintf(outputFile, "RABBIT");
                         break;
@@ -1083,24 +2743,34 @@ void printResults(FILE *outputFile, InputData *inputData, WorldSlot *worldSlot)
 
 }
 
-void freeWorldMatrix(InputData *data, WorldSlot *worldMatrix) {
-    for (int row = 0; row < data->rows; row++) {
-        for (int col = 0; col < data->columns; col++) {
-            WorldSlot *slot = &worldMatrix[PROJECT(data->columns, row, col)];
-            if (slot->slotContent == RABBIT) {
-                freeRabbitInfo(slot->entityInfo.rabbitInfo);
-            } else if (slot->slotContent == FOX) {
-                freeFoxInfo(slot->entityInfo.foxInfo);
-            }
+void freeWorldBuffer(World *world) {
+    //All of the planes share the allocation that starts at the first plane
+    freeMatrix((void **) &world->currentGenProc);
 
-            freeMovementForSlot(slot->defaultPossibleMoveDirections);
+    freePages(world->occupied);
 
-        }
-    }
+    free(world);
+}
 
+void freeWorldMatrix(InputData *data, World *worldMatrix) {
     free(data->entitiesPerRow);
     free(data->entitiesAccumulatedPerRow);
 
+    freeEntityIndex(data->entityIndex);
+
+    free(data->moveDecisions);
+
+    freeMatrix((void **) &data->borderSlots);
+    freeMatrix((void **) &data->borderArrivals);
+    free(data->borderPhases);
+
+    free(data->entitiesPerBlock);
+
     free(data);
-    freeMatrix((void **) &worldMatrix);
+
+    freeMatrix((void **) &worldMatrix->topology->defaultMoves);
+    freePages(worldMatrix->topology->rocks);
+    free(worldMatrix->topology);
+
+    freeWorldBuffer(worldMatrix);
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define TRABALHO_2_RABBITSANDFOXES_H
 
 #include <stdio.h>
+#include <stdint.h>
 #include "linkedlist.h"
 
 typedef enum MoveDirection_ MoveDirection;
@@ -12,8 +13,46 @@ struct ThreadedData;
 
 struct ThreadConflictData;
 
+struct World_;
+
 typedef struct ThreadRowData_ ThreadRowData;
 
+typedef struct EntityIndex_ EntityIndex;
+
+typedef struct SimulationPool_ SimulationPool;
+
+/**
+ * How the generations are computed, chosen at startup. All of them produce the same results when run sequentially
+ */
+typedef enum Engine_ {
+
+    //Visit the entities through the entity index, looking at the neighbours of each one
+    SLOT_ENGINE = 0,
+
+    //Go through the bit planes of each row, working out the moves of 64 slots at a time
+    BITBOARD_ENGINE = 1,
+
+    //Each slot pulls in the animals that move into it, instead of the animals being pushed into their new slots.
+    //A thread only writes its own rows, so there are no conflicts to hand over to the other threads
+    GATHER_ENGINE = 2,
+
+    //The gather engine, running the fox phase of each row right behind the rabbit phase, in the same sweep
+    FUSED_ENGINE = 3,
+
+    //The bitboard engine, with the moves into the rows next to the borders between threads claimed right away with
+    //a compare and swap, instead of being handed over as conflicts after a handshake with the threads next to ours
+    ATOMIC_ENGINE = 4,
+
+    //The gather engine, with the world split into tiles (Blocks of rows and columns) instead of strips of rows, so
+    //there can be more threads than rows
+    TILED_ENGINE = 5,
+
+    //The gather engine, with the rows of each thread split into small chunks that the threads that are done with
+    //their own rows can steal, so the load is balanced within a generation
+    STEALING_ENGINE = 6
+
+} Engine;
+
 typedef struct InputData_ {
 
     int gen_proc_rabbits, gen_proc_foxes, gen_food_foxes;
@@ -31,6 +70,36 @@ typedef struct InputData_ {
 
     int *entitiesPerRow;
 
+    //Where the entities are in each buffer of the world (See entity_index.h)
+    EntityIndex *entityIndex;
+
+    Engine engine;
+
+    //Classifies the neighbours of a segment of a row for the slot engine (See neighbour_kernel.h)
+    void (*neighbourKernel)(struct World_ *world, int row, int startCol, uint8_t *rabbitMasks, uint8_t *emptyMasks);
+
+    //The moves decided in the last rows by each thread of the gather engine, as bit planes (NULL for the other engines)
+    uint64_t *moveDecisions;
+
+    //The slots of the rows next to the borders between threads in the atomic engine, packed in a word per slot so
+    //the moves into them can be claimed with a compare and swap (NULL for the other engines)
+    uint64_t *borderSlots;
+
+    //The moves into each slot of those rows, a word for each neighbour they come from, so the thread that owns the row
+    //can count them in the order the other engines do (NULL for the other engines). Only the pages of the rows that
+    //are next to a border are ever touched
+    uint64_t *borderArrivals;
+
+    //The last phase each row was prepared in, so the threads next to it know when they can claim its slots. Shifted
+    //left by one, the lowest bit is set when a thread is asleep waiting for it (See publishPhase)
+    uint32_t *borderPhases;
+
+    //The amount of blocks of TILE_BLOCK_COLUMNS columns in a row (See threads.h)
+    int columnBlocks;
+
+    //The entities in each block of each row, which the tiled engine is balanced with (NULL for the other engines)
+    int *entitiesPerBlock;
+
 } InputData;
 
 typedef enum SlotContent_ {
@@ -42,78 +111,201 @@ typedef enum SlotContent_ {
 
 } SlotContent;
 
-typedef struct RabbitInfo_ {
-
-    int genUpdated, prevGen;
+/**
+ * The state of whatever occupies a slot, stored inline in the slot so that
+ * births, deaths and moves never touch the allocator (8 bytes)
+ */
+typedef struct EntityInfo_ {
 
-    int currentGen;
+    //The SlotContent of the slot, kept in a single byte
+    uint8_t slotContent;
 
-} RabbitInfo;
+    //Parity of the last generation the entity was updated in
+    //(Every living entity is updated once per generation, so the parity is enough to know if
+    //it has already been updated in the current one)
+    uint8_t genUpdated;
 
-typedef struct FoxInfo_ {
-    int genUpdated, prevGenProc;
+    //Generations since the fox has eaten a rabbit (Bounded by gen_food_foxes)
+    uint16_t currentGenFood;
 
-    int currentGenProc;
+    //Generations since the entity was born or last procriated
+    uint32_t currentGenProc;
 
-    //Generations since the fox has eaten a rabbit
-    int currentGenFood;
-} FoxInfo;
+} EntityInfo;
 
-typedef struct WorldSlot_ {
+/**
+ * The part of the world that never changes after the initial data is read (Rocks never move),
+ * shared read only by every copy of the world
+ */
+typedef struct WorldTopology_ {
 
-    SlotContent slotContent;
+    int rows, columns;
 
-    //Store the default possible movement rabbitDirections
+    //Store the move mask of the moves that can ever be made from each slot (See getDefaultMoveMask)
     //so we don't have to calculate them every time
-    //This way, we only have to check the move rabbitDirections that are here
-    //For empty slots
-    int defaultP;
+    //This way, we only have to check the neighbours in the directions that are here
+    uint8_t *defaultMoves;
+
+    //One bit per slot with a rock, in the same layout as the occupancy bitmap of the world
+    uint64_t *rocks;
+
+} WorldTopology;
+
+/**
+ * The dynamic state of the world, stored as a structure of arrays: every field of a slot lives in its own plane,
+ * indexed with PROJECT(columns, row, col).
+ *
+ * This way scans that only look for rabbits or foxes read a single byte per slot.
+ *
+ * The world is double buffered: each phase of a generation reads one buffer and writes the other one
+ * (See initWorldBuffer)
+ */
+typedef struct World_ {
+
+    int rows, columns;
 
-    MoveDirection *defaultPossibleMoveDirections;
+    WorldTopology *topology;
 
-    union {
+    //The SlotContent of each slot
+    uint8_t *slotContent;
 
-        FoxInfo *foxInfo;
+    //The age counters of the entity in each slot (See EntityInfo)
+    uint8_t *genUpdated;
 
-        RabbitInfo *rabbitInfo;
+    uint16_t *currentGenFood;
 
-    } entityInfo;
+    uint32_t *currentGenProc;
 
-} WorldSlot;
+    //One bit per slot, set when the slot is not EMPTY. Each row starts at a new word, so a row's words are only
+    //ever written by the thread that owns it
+    uint64_t *occupied;
+
+    //One bit per word of occupied, set when that word has any slot occupied (Also kept per row)
+    uint64_t *occupiedSummary;
+
+    //The bit planes of each species, in the same layout as occupied
+    uint64_t *rabbits, *foxes;
+
+    int occupiedWordsPerRow, summaryWordsPerRow;
+
+} World;
+
+static inline void getEntity(World *world, int slot, EntityInfo *destination) {
+    destination->slotContent = world->slotContent[slot];
+    destination->genUpdated = world->genUpdated[slot];
+    destination->currentGenFood = world->currentGenFood[slot];
+    destination->currentGenProc = world->currentGenProc[slot];
+}
+
+static inline void setEntity(World *world, int slot, EntityInfo *entity) {
+    world->slotContent[slot] = entity->slotContent;
+    world->genUpdated[slot] = entity->genUpdated;
+    world->currentGenFood[slot] = entity->currentGenFood;
+    world->currentGenProc[slot] = entity->currentGenProc;
+}
+
+static inline void markOccupied(World *world, int row, int col, SlotContent content) {
+    int word = col >> 6, wordIndex = row * world->occupiedWordsPerRow + word;
+
+    uint64_t bit = 1ULL << (col & 63);
+
+    world->occupied[wordIndex] |= bit;
+    world->occupiedSummary[row * world->summaryWordsPerRow + (word >> 6)] |= 1ULL << (word & 63);
+
+    //Another entity can be replaced in the slot, so the planes of both species are written
+    if (content == RABBIT) {
+        world->rabbits[wordIndex] |= bit;
+        world->foxes[wordIndex] &= ~bit;
+    } else if (content == FOX) {
+        world->foxes[wordIndex] |= bit;
+        world->rabbits[wordIndex] &= ~bit;
+    }
+}
+
+static inline void markEmpty(World *world, int row, int col) {
+    int word = col >> 6, wordIndex = row * world->occupiedWordsPerRow + word;
+
+    uint64_t *bits = &world->occupied[wordIndex];
+
+    *bits &= ~(1ULL << (col & 63));
+
+    world->rabbits[wordIndex] &= ~(1ULL << (col & 63));
+    world->foxes[wordIndex] &= ~(1ULL << (col & 63));
+
+    if (*bits == 0) {
+        world->occupiedSummary[row * world->summaryWordsPerRow + (word >> 6)] &= ~(1ULL << (word & 63));
+    }
+}
 
 InputData *readInputData(FILE *file);
 
 /**
- * Initialize the tray of data, returns a matrix where each position is a WorldSlot
+ * Initialize the tray of data, returns a world where each plane is a matrix with a position per slot
  * @param data
  * @return
  */
-WorldSlot *initWorld(InputData *data);
+World *initWorld(InputData *data);
 
-void executeSequentialThread(FILE *inputFile, FILE *outputFile);
+/**
+ * Initialize a second buffer for the world, sharing the world's topology
+ * @param world
+ * @return
+ */
+World *initWorldBuffer(World *world);
 
-void executeWithThreadCount(int threadCount, FILE *inputFile, FILE *outputFile);
+void executeSequentialThread(Engine engine, FILE *inputFile, FILE *outputFile);
 
-void readWorldInitialData(FILE *inputFile, InputData *inputData, WorldSlot *world);
+void executeWithThreadCount(int threadCount, Engine engine, FILE *inputFile, FILE *outputFile);
+
+/**
+ * Run the world read from inputFile with threadCount threads, without writing the results
+ *
+ * @return How long the generations took, in microseconds
+ */
+long timeWithThreadCount(int threadCount, Engine engine, FILE *inputFile);
+
+/**
+ * Start a pool of maxThreads threads that stay parked between runs, so a program that runs many worlds doesn't
+ * have to create the threads (And their semaphores, barrier and conflict lists) for each one
+ */
+SimulationPool *initSimulationPool(int maxThreads);
+
+/**
+ * Run the world read from inputFile on threadCount of the threads of the pool (At most the amount it was started
+ * with), writing the results to outputFile if it's not NULL. The worlds of successive runs can have any size
+ *
+ * @return How long the run took (From the start of the threads to the end of the last generation), in microseconds
+ */
+long executeWithPool(SimulationPool *pool, int threadCount, Engine engine, FILE *inputFile, FILE *outputFile);
+
+/**
+ * Wake up the threads of the pool so they exit, and free it
+ */
+void freeSimulationPool(SimulationPool *pool);
+
+void readWorldInitialData(FILE *inputFile, InputData *inputData, World *world);
 
 /**
  * Perform a generation of a world, within the bounds given by start of startRow and end of endRow
  *
- * Returns a linked list
+ * The rabbits move from world into nextWorld, and then the foxes move from nextWorld back into world,
+ * so at the end of the generation its results are in world
+ *
  * @param inputData
  * @param world
- * @param startRow
- * @param endRow
- * @return
+ * @param nextWorld
+ * @param threadRowData
  */
 void
 performGeneration(int threadNumber, int genNumber, InputData *inputData,
-                  struct ThreadedData *threadedData, WorldSlot *world, ThreadRowData *threadRowData);
+                  struct ThreadedData *threadedData, World *world, World *nextWorld, ThreadRowData *threadRowData);
 
 void handleConflicts(struct ThreadConflictData *conflictData, int conflictCount, Conflict *conflicts);
 
-void printResults(FILE *outputFile, InputData *inputData, WorldSlot *world);
+void printResults(FILE *outputFile, InputData *inputData, World *world);
+
+void freeWorldBuffer(World *world);
 
-void freeWorldMatrix(InputData *data, WorldSlot *worldMatrix);
+void freeWorldMatrix(InputData *data, World *worldMatrix);
 
 #endif //TRABALHO_2_RABBITSANDFOXES_H
@@ -1,30 +1,97 @@
 
 #include "threads.h"
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include "semaphore.h"
+#include "matrix_utils.h"
+
+//The bits of Handshake.arrived
+#define HANDSHAKE_ABOVE 0x1
+#define HANDSHAKE_BELOW 0x2
+#define HANDSHAKE_SLEEPING 0x4
+
+//The lowest bit of Handshake.phases
+#define PHASE_WAITERS 0x1
+
+//The bits of TreeBarrierNode.arrived: the sense of the episode, and if a thread is asleep waiting for it
+#define BARRIER_SENSE 0x1
+#define BARRIER_WAITERS 0x2
+
+//How many times a thread checks if its neighbours are done before going to sleep
+#define HANDSHAKE_SPINS 256
+
+//The structs the threads wait on each get a cache line of their own
+#define CACHE_LINE_SIZE 64
+
+/**
+ * Allocate size bytes, zeroed, starting at a cache line (allocPages only aligns its heap allocations to 16 bytes).
+ * Freed with free
+ */
+static void *allocCacheLines(size_t size) {
+    void *lines;
+
+    if (posix_memalign(&lines, CACHE_LINE_SIZE, size) != 0) return NULL;
+
+    memset(lines, 0, size);
+
+    return lines;
+}
 
 void initThreadData(int threadCount, InputData *data, struct ThreadedData *destination) {
     destination->threads = malloc(sizeof(pthread_t) * threadCount);
 
     destination->conflictPerThreads = malloc(sizeof(Conflicts *) * threadCount);
 
-    destination->threadSemaphores = malloc(sizeof(sem_t) * threadCount);
     destination->precedingSemaphores = malloc(sizeof(sem_t) * threadCount);
 
-    pthread_barrier_init(&destination->barrier, NULL, threadCount);
+    initTreeBarrier(&destination->barrier, threadCount);
+
+    destination->rowDeques = calloc(threadCount, sizeof(uint64_t));
+
+    destination->handshakes = allocCacheLines(sizeof(Handshake) * threadCount);
 
     for (int i = 0; i < threadCount; i++) {
         destination->conflictPerThreads[i] = malloc(sizeof(Conflicts));
 
         destination->conflictPerThreads[i]->aboveCount = 0;
-        destination->conflictPerThreads[i]->above = malloc(sizeof(Conflict) * data->columns);
+        destination->conflictPerThreads[i]->above = allocPages(sizeof(Conflict) * data->columns);
         destination->conflictPerThreads[i]->bellowCount = 0;
-        destination->conflictPerThreads[i]->bellow = malloc(sizeof(Conflict) * data->columns);
+        destination->conflictPerThreads[i]->bellow = allocPages(sizeof(Conflict) * data->columns);
+        destination->conflictPerThreads[i]->capacity = data->columns;
 
-        sem_init(&destination->threadSemaphores[i], 0, 0);
         sem_init(&destination->precedingSemaphores[i], 0, 0);
+    }
+}
 
-//        printf("Initialized semaphore on address %p\n", &destination->threadSemaphores[i]);
+void reuseThreadData(int threadCount, InputData *data, struct ThreadedData *threadedData) {
+
+    //The barrier can't be reused with a different amount of threads
+    if (threadedData->barrier.threads != threadCount) {
+        freeTreeBarrier(&threadedData->barrier);
+        initTreeBarrier(&threadedData->barrier, threadCount);
+    }
+
+    for (int thread = 0; thread < threadCount; thread++) {
+        Conflicts *conflicts = threadedData->conflictPerThreads[thread];
+
+        if (conflicts->capacity < data->columns) {
+            freePages(conflicts->above);
+            freePages(conflicts->bellow);
+
+            conflicts->above = allocPages(sizeof(Conflict) * data->columns);
+            conflicts->bellow = allocPages(sizeof(Conflict) * data->columns);
+            conflicts->capacity = data->columns;
+        }
+
+        clearConflictsForThread(thread, threadedData);
+
+        //Every run starts again at phase 0
+        memset(&threadedData->handshakes[thread], 0, sizeof(Handshake));
     }
 }
 
@@ -39,7 +106,7 @@ void clearConflictsForThread(int thread, struct ThreadedData *threadedData) {
     conflictsForThread->bellowCount = 0;
 }
 
-void initAndAppendConflict(Conflicts *conflicts, int above, int newRow, int newCol, WorldSlot *slot) {
+void initAndAppendConflict(Conflicts *conflicts, int above, int newRow, int newCol, EntityInfo *entity) {
 
     //Conflict, we have to access another thread's memory space, create a conflict
     //And store it in our conflict list
@@ -59,18 +126,7 @@ void initAndAppendConflict(Conflicts *conflicts, int above, int newRow, int newC
     conflict->newRow = newRow;
     conflict->newCol = newCol;
 
-    conflict->slotContent = slot->slotContent;
-
-    switch (slot->slotContent) {
-        case FOX:
-            conflict->data = slot->entityInfo.foxInfo;
-            break;
-        case RABBIT:
-            conflict->data = slot->entityInfo.rabbitInfo;
-            break;
-        default:
-            break;
-    }
+    conflict->entity = *entity;
 
     (*current)++;
 }
@@ -104,6 +160,18 @@ int findRowWithEntities(int entityCount, const int *entitiesPerRowAccumulated, i
 
 int verifyThreadInputs(InputData *inputData) {
 
+    if (inputData->entitiesPerBlock != NULL) {
+        //Every tile needs at least a row and a block of columns
+        if (inputData->threads > inputData->rows * inputData->columnBlocks) {
+            fprintf(stderr, "The number of threads cannot be larger than the number of tiles (%d)!",
+                    inputData->rows * inputData->columnBlocks);
+
+            exit(EXIT_FAILURE);
+        }
+
+        return 1;
+    }
+
     if (inputData->threads > inputData->rows) {
         fprintf(stderr, "The number of threads cannot be larger than the number of rows!");
 
@@ -113,14 +181,19 @@ int verifyThreadInputs(InputData *inputData) {
     return 1;
 }
 
-void calculateOptimalThreadBalance(int threadCount, ThreadRowData *threadDatas, InputData *data) {
-    int totalEntities = data->entitiesAccumulatedPerRow[data->rows - 1];
+/**
+ * Cut the rows into a strip for each thread, with about the same amount of entities in each one
+ * (Given by the amount of entities up to each row, entitiesAccumulatedPerRow)
+ */
+static void balanceRows(int threadCount, ThreadRowData *threadDatas, const int *entitiesAccumulatedPerRow,
+                        int rows) {
+    int totalEntities = entitiesAccumulatedPerRow[rows - 1];
 
     int optimalEntitiesPerThread = totalEntities / threadCount;
 
     int endOfPrevious = 0;
 
-    int lastRowIndex = data->rows - 1;
+    int lastRowIndex = rows - 1;
 
     //We want thread to start
     for (int thread = 1; thread <= threadCount; thread++) {
@@ -134,8 +207,7 @@ void calculateOptimalThreadBalance(int threadCount, ThreadRowData *threadDatas,
         /**
          * Employ binary search to find
          */
-        int rowWithCumulative = findRowWithEntities(optimalCumulativeCount, data->entitiesAccumulatedPerRow,
-                                                    data->rows);
+        int rowWithCumulative = findRowWithEntities(optimalCumulativeCount, entitiesAccumulatedPerRow, rows);
 
         //We have to make sure that there are still some rows for the upcoming threads
         if ((lastRowIndex - rowWithCumulative) < threadsRemaining) {
@@ -147,8 +219,8 @@ void calculateOptimalThreadBalance(int threadCount, ThreadRowData *threadDatas,
         }
 
         //If we're the last thread remaining, take up the slack of rows that haven't been picked
-        if (threadsRemaining == 0 && rowWithCumulative < data->rows - 1) {
-            rowWithCumulative = data->rows - 1;
+        if (threadsRemaining == 0 && rowWithCumulative < rows - 1) {
+            rowWithCumulative = rows - 1;
         }
 
         endRow = rowWithCumulative;
@@ -163,97 +235,445 @@ void calculateOptimalThreadBalance(int threadCount, ThreadRowData *threadDatas,
 
 }
 
+void calculateOptimalThreadBalance(int threadCount, ThreadRowData *threadDatas, InputData *data) {
+
+    if (data->entitiesPerBlock != NULL) {
+        calculateOptimalTileBalance(threadCount, threadDatas, data);
+
+        return;
+    }
+
+    balanceRows(threadCount, threadDatas, data->entitiesAccumulatedPerRow, data->rows);
+
+    for (int thread = 0; thread < threadCount; thread++) {
+        threadDatas[thread].startWord = 0;
+        threadDatas[thread].endWord = (data->columns + 63) / 64 - 1;
+    }
+}
+
+/**
+ * The amount of bands the columns are cut into that makes the tiles closest to squares (With the shortest borders),
+ * out of the ones that leave at least a row for every thread of a band
+ */
+static int getTileBandCount(int threadCount, InputData *data) {
+
+    int fewest = (threadCount + data->rows - 1) / data->rows,
+            most = threadCount < data->columnBlocks ? threadCount : data->columnBlocks;
+
+    int bestBands = fewest;
+
+    double bestBorder = -1;
+
+    for (int bands = fewest; bands <= most; bands++) {
+        //The height plus the width of a tile
+        double border = (double) data->rows * bands / threadCount + (double) data->columns / bands;
+
+        if (bestBorder < 0 || border < bestBorder) {
+            bestBorder = border;
+            bestBands = bands;
+        }
+    }
+
+    return bestBands;
+}
+
+void calculateOptimalTileBalance(int threadCount, ThreadRowData *threadDatas, InputData *data) {
+
+    int rows = data->rows, blocks = data->columnBlocks, wordsPerRow = (data->columns + 63) / 64;
+
+    int *blockEntities = calloc(blocks, sizeof(int)), *bandAccumulated = malloc(sizeof(int) * rows);
+
+    int totalEntities = 0;
+
+    for (int row = 0; row < rows; row++) {
+        int rowEntities = 0;
+
+        for (int block = 0; block < blocks; block++) {
+            int entities = data->entitiesPerBlock[row * blocks + block];
+
+            rowEntities += entities;
+            blockEntities[block] += entities;
+        }
+
+        totalEntities += rowEntities;
+
+        data->entitiesPerRow[row] = rowEntities;
+        data->entitiesAccumulatedPerRow[row] = totalEntities;
+    }
+
+    int bands = getTileBandCount(threadCount, data);
+
+    int startBlock = 0, firstThread = 0, accumulated = 0;
+
+    for (int band = 0; band < bands; band++) {
+
+        int bandThreads = threadCount / bands + (band < threadCount % bands),
+                bandsRemaining = bands - band - 1;
+
+        //Same as the strips, the band ends where the entities up to it reach the share of the threads up to it.
+        //The last band takes up the slack of blocks that haven't been picked
+        long optimalCumulativeCount = (long) totalEntities * (firstThread + bandThreads) / threadCount;
+
+        int endBlock = startBlock;
+
+        accumulated += blockEntities[startBlock];
+
+        while (endBlock < blocks - 1 - bandsRemaining &&
+               (accumulated < optimalCumulativeCount || bandsRemaining == 0)) {
+            endBlock++;
+
+            accumulated += blockEntities[endBlock];
+        }
+
+        int bandEntities = 0;
+
+        for (int row = 0; row < rows; row++) {
+            for (int block = startBlock; block <= endBlock; block++) {
+                bandEntities += data->entitiesPerBlock[row * blocks + block];
+            }
+
+            bandAccumulated[row] = bandEntities;
+        }
+
+        balanceRows(bandThreads, &threadDatas[firstThread], bandAccumulated, rows);
+
+        int endWord = (endBlock + 1) * TILE_BLOCK_WORDS;
+
+        for (int thread = firstThread; thread < firstThread + bandThreads; thread++) {
+            threadDatas[thread].startWord = startBlock * TILE_BLOCK_WORDS;
+            threadDatas[thread].endWord = (endWord < wordsPerRow ? endWord : wordsPerRow) - 1;
+        }
+
+        firstThread += bandThreads;
+        startBlock = endBlock + 1;
+    }
+
+    free(blockEntities);
+    free(bandAccumulated);
+}
+
 void freeConflict(Conflict *conflict) {
     free(conflict);
 }
 
-void synchronizeThreadAndSolveConflicts(struct ThreadConflictData *conflictData) {
-    if (conflictData->inputData->threads > 1) {
+static inline void relaxWhileSpinning(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
 
-        struct ThreadedData *threadedData = conflictData->threadedData;
+static long long monotonicNanos(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/**
+ * Let the thread of the handshake know that the neighbour on the side (HANDSHAKE_ABOVE or HANDSHAKE_BELOW) is done
+ * with the phase, waking it up if it's asleep
+ */
+static void postHandshake(Handshake *handshake, uint32_t side) {
+
+    //Releases the conflicts written in the phase to the thread
+    uint32_t previous = __atomic_fetch_or(&handshake->arrived, side, __ATOMIC_RELEASE);
 
-        if (conflictData->threadNum == 0) {
+    if (previous & HANDSHAKE_SLEEPING) {
+        syscall(SYS_futex, &handshake->arrived, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    }
+}
+
+/**
+ * Wait until another neighbour is done (Other than the ones in seen): spin for a while, in case it's about to be
+ * done, and then sleep on the futex until it wakes us up
+ *
+ * @return The neighbours that are done
+ */
+static uint32_t waitForHandshake(Handshake *handshake, uint32_t seen) {
+
+    long long start = monotonicNanos();
+
+    uint32_t arrived;
+
+    for (int spin = 0; spin < HANDSHAKE_SPINS; spin++) {
+        arrived = __atomic_load_n(&handshake->arrived, __ATOMIC_ACQUIRE) & ~HANDSHAKE_SLEEPING;
 
-            //We only need one post as the top thread only synchronizes with the thread bellow it
-            sem_post(&threadedData->threadSemaphores[conflictData->threadNum]);
-            //The first thread will only sync with one thread
+        if (arrived != seen) {
+            handshake->counters.spinNanos += monotonicNanos() - start;
+            handshake->counters.spins++;
 
-            //Wait for the semaphores of thread below
-            sem_wait(&threadedData->threadSemaphores[conflictData->threadNum + 1]);
+            return arrived;
+        }
 
-            Conflicts *bottomConflicts = threadedData->conflictPerThreads[conflictData->threadNum + 1];
+        relaxWhileSpinning();
+    }
 
-//            printf("Thread %d called handle conflicts with thread %d\n", conflictData->threadNum,  conflictData->threadNum + 1);
+    long long blockStart = monotonicNanos();
 
-            handleConflicts(conflictData, bottomConflicts->aboveCount, bottomConflicts->above);
+    handshake->counters.spinNanos += blockStart - start;
 
-        } else if (conflictData->threadNum > 0 && conflictData->threadNum < (conflictData->inputData->threads - 1)) {
+    for (;;) {
+        uint32_t current = __atomic_load_n(&handshake->arrived, __ATOMIC_ACQUIRE);
 
-            sem_t *our_sem = &threadedData->threadSemaphores[conflictData->threadNum];
-            //Since middle threads will have to sync with 2 different threads, we
-            //Increment the semaphore to 2
-            sem_post(our_sem);
-            sem_post(our_sem);
+        arrived = current & ~HANDSHAKE_SLEEPING;
 
-            int topThread = conflictData->threadNum - 1, bottThread = conflictData->threadNum + 1;
+        if (arrived != seen) break;
 
-            sem_t *topSem = &threadedData->threadSemaphores[topThread],
-                    *bottomSem = &threadedData->threadSemaphores[bottThread];
+        //The neighbours only wake us up if they see we're asleep. If one of them got here in the meantime, look again
+        if (!(current & HANDSHAKE_SLEEPING) &&
+            !__atomic_compare_exchange_n(&handshake->arrived, &current, current | HANDSHAKE_SLEEPING, 0,
+                                         __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
 
-            int topDone = 0, botDone = 0;
-            int sems_left = 2;
+        syscall(SYS_futex, &handshake->arrived, FUTEX_WAIT_PRIVATE, current | HANDSHAKE_SLEEPING, NULL, NULL, 0);
+    }
 
-            //We don't have to wait for both semaphores to solve the conflicts
-            //Try to unlock the semaphores and do them as soon as they are unlocked
-            while (sems_left > 0) {
-                if (!topDone) {
-                    if (sem_trywait(topSem) == 0) {
+    handshake->counters.blockNanos += monotonicNanos() - blockStart;
+    handshake->counters.blocks++;
 
-                        //Since we are bellow the thread that is above us (Who knew?)
-                        //We get the conflicts of that thread with the thread bellow it (That's us!)
+    return arrived;
+}
 
-                        Conflicts *topConf = threadedData->conflictPerThreads[topThread];
+void finishPhase(int threadNumber, struct ThreadedData *threadedData) {
 
-//                        printf("Thread %d called handle conflicts with thread %d\n", conflictData->threadNum,  topThread);
-                        handleConflicts(conflictData, topConf->bellowCount, topConf->bellow);
+    uint32_t *phases = &threadedData->handshakes[threadNumber].phases;
 
-                        sems_left--;
-                        topDone = 1;
-                    }
-                }
+    //Releases the rows written in the phase to the threads that wait for it
+    uint32_t previous = __atomic_fetch_add(phases, 2, __ATOMIC_RELEASE);
 
-                if (!botDone) {
-                    //If there are 2 semaphore left, then the bottom one is still not done
-                    //If there's only one, then the bottom one is done if the top isn't
-                    if (sem_trywait(bottomSem) == 0) {
-                        //Since we are above the thread that is bellow us (Again, who knew? :))
-                        //We get the conflicts of that thread with the thread above it (That's us again!)
-                        Conflicts *botConf = threadedData->conflictPerThreads[bottThread];
+    if (previous & PHASE_WAITERS) {
+        __atomic_fetch_and(phases, ~PHASE_WAITERS, __ATOMIC_RELAXED);
 
-//                        printf("Thread %d called handle conflicts with thread %d\n", conflictData->threadNum,  bottThread);
-                        handleConflicts(conflictData, botConf->aboveCount, botConf->above);
+        syscall(SYS_futex, phases, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    }
+}
 
-                        botDone = 1;
-                        sems_left--;
-                    }
-                }
+void publishPhase(uint32_t *phases, uint32_t phase) {
+
+    //Releases everything written before the phase to the threads that wait for it
+    uint32_t previous = __atomic_exchange_n(phases, phase << 1, __ATOMIC_RELEASE);
+
+    if (previous & PHASE_WAITERS) {
+        syscall(SYS_futex, phases, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+void waitForPhase(uint32_t *phases, uint32_t phase, HandshakeCounters *counters) {
+
+    if (__atomic_load_n(phases, __ATOMIC_ACQUIRE) >> 1 >= phase) return;
+
+    long long start = monotonicNanos();
+
+    for (int spin = 0; spin < HANDSHAKE_SPINS; spin++) {
+        if (__atomic_load_n(phases, __ATOMIC_ACQUIRE) >> 1 >= phase) {
+            if (counters != NULL) {
+                counters->spinNanos += monotonicNanos() - start;
+                counters->spins++;
             }
 
-        } else {
-            //The last thread will also only sync with one thread
-            sem_post(&threadedData->threadSemaphores[conflictData->threadNum]);
+            return;
+        }
+
+        relaxWhileSpinning();
+    }
+
+    long long blockStart = monotonicNanos();
+
+    for (;;) {
+        uint32_t current = __atomic_load_n(phases, __ATOMIC_ACQUIRE);
+
+        if (current >> 1 >= phase) break;
+
+        //Several threads can wait for the same one, the first one to go to sleep sets the bit for all of them
+        if (!(current & PHASE_WAITERS) &&
+            !__atomic_compare_exchange_n(phases, &current, current | PHASE_WAITERS, 0,
+                                         __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+
+        syscall(SYS_futex, phases, FUTEX_WAIT_PRIVATE, current | PHASE_WAITERS, NULL, NULL, 0);
+    }
+
+    if (counters != NULL) {
+        counters->spinNanos += blockStart - start;
+        counters->blockNanos += monotonicNanos() - blockStart;
+        counters->blocks++;
+    }
+}
+
+void waitForNeighbourPhases(int threadNumber, int phase, int reach, InputData *inputData, ThreadRowData *threadRowData,
+                            struct ThreadedData *threadedData) {
+
+    HandshakeCounters *counters = &threadedData->handshakes[threadNumber].counters;
+
+    int firstRow = threadRowData[threadNumber].startRow - reach, lastRow = threadRowData[threadNumber].endRow + reach;
+
+    //The rows of the threads are in order, so the ones we depend on are the ones right next to ours
+    for (int thread = threadNumber - 1; thread >= 0 && threadRowData[thread].endRow >= firstRow; thread--) {
+        waitForPhase(&threadedData->handshakes[thread].phases, phase, counters);
+    }
+
+    for (int thread = threadNumber + 1; thread < inputData->threads && threadRowData[thread].startRow <= lastRow;
+         thread++) {
+        waitForPhase(&threadedData->handshakes[thread].phases, phase, counters);
+    }
+}
+
+void initTreeBarrier(TreeBarrier *barrier, int threads) {
+    barrier->threads = threads;
+
+    //With more threads than CPUs, the thread we would spin for may be waiting for our CPU
+    barrier->spins = threads <= sysconf(_SC_NPROCESSORS_ONLN) ? HANDSHAKE_SPINS : 0;
+
+    barrier->nodes = allocCacheLines(sizeof(TreeBarrierNode) * (threads + 1));
+
+    barrier->release = &barrier->nodes[threads];
+}
+
+/**
+ * Set the flag of the node to the sense of the episode, waking up the threads asleep waiting for it
+ */
+static void setBarrierFlag(TreeBarrierNode *node, uint32_t sense) {
+
+    //Releases everything written before the barrier (By us and the threads under us) to the thread that waits for it
+    uint32_t previous = __atomic_exchange_n(&node->arrived, sense, __ATOMIC_RELEASE);
+
+    if (previous & BARRIER_WAITERS) {
+        syscall(SYS_futex, &node->arrived, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+/**
+ * Wait for the flag of the node to be set to the sense of the episode, spinning for a while and then sleeping on the
+ * futex (Same as waitForPhases)
+ */
+static void waitForBarrierFlag(TreeBarrier *barrier, TreeBarrierNode *node, uint32_t sense) {
+
+    for (int spin = 0; spin < barrier->spins; spin++) {
+        if ((__atomic_load_n(&node->arrived, __ATOMIC_ACQUIRE) & BARRIER_SENSE) == sense) return;
+
+        relaxWhileSpinning();
+    }
+
+    for (;;) {
+        uint32_t current = __atomic_load_n(&node->arrived, __ATOMIC_ACQUIRE);
+
+        if ((current & BARRIER_SENSE) == sense) return;
+
+        //All the threads wait on the release node, the first one to go to sleep sets the bit for all of them
+        if (!(current & BARRIER_WAITERS) &&
+            !__atomic_compare_exchange_n(&node->arrived, &current, current | BARRIER_WAITERS, 0,
+                                         __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+
+        syscall(SYS_futex, &node->arrived, FUTEX_WAIT_PRIVATE, current | BARRIER_WAITERS, NULL, NULL, 0);
+    }
+}
+
+int waitAtTreeBarrier(TreeBarrier *barrier, int threadNumber) {
+
+    TreeBarrierNode *ourNode = &barrier->nodes[threadNumber];
+
+    //The flags alternate between the senses, so a flag set in the last episode can't be mistaken for this one
+    uint32_t sense = ourNode->sense ^ BARRIER_SENSE;
 
-            int topThread = conflictData->threadNum - 1;
+    ourNode->sense = sense;
 
-            sem_t *topSem = &threadedData->threadSemaphores[topThread];
+    int firstChild = threadNumber * TREE_BARRIER_FAN_IN + 1;
 
-            sem_wait(topSem);
+    for (int child = firstChild; child < firstChild + TREE_BARRIER_FAN_IN && child < barrier->threads; child++) {
+        waitForBarrierFlag(barrier, &barrier->nodes[child], sense);
+    }
+
+    if (threadNumber == 0) {
+        //Every thread has arrived
+        setBarrierFlag(barrier->release, sense);
+
+        return 1;
+    }
+
+    //Our parent can't be released (And neither can we) before it has seen our flag, so the flag isn't set again
+    //before it's seen
+    setBarrierFlag(ourNode, sense);
+
+    waitForBarrierFlag(barrier, barrier->release, sense);
+
+    return 0;
+}
+
+void freeTreeBarrier(TreeBarrier *barrier) {
+    free(barrier->nodes);
+}
+
+void sumHandshakeCounters(int threadCount, struct ThreadedData *threadedData, HandshakeCounters *destination) {
+
+    memset(destination, 0, sizeof(HandshakeCounters));
+
+    for (int thread = 0; thread < threadCount; thread++) {
+        HandshakeCounters *counters = &threadedData->handshakes[thread].counters;
+
+        destination->spinNanos += counters->spinNanos;
+        destination->blockNanos += counters->blockNanos;
+        destination->spins += counters->spins;
+        destination->blocks += counters->blocks;
+    }
+}
+
+void printHandshakeCounters(FILE *outputFile, HandshakeCounters *counters) {
+    fprintf(outputFile, "Waits for neighbours: %lld waits spinning (%lld us), %lld waits asleep (%lld us)\n",
+            counters->spins, counters->spinNanos / 1000, counters->blocks, counters->blockNanos / 1000);
+}
+
+void synchronizeThreadAndSolveConflicts(struct ThreadConflictData *conflictData) {
+    if (conflictData->inputData->threads > 1) {
+
+        struct ThreadedData *threadedData = conflictData->threadedData;
+
+        int thread = conflictData->threadNum, lastThread = conflictData->inputData->threads - 1;
+
+        //Our conflicts are ready, let the threads next to us know (The first and last threads only have one)
+        if (thread > 0) {
+            postHandshake(&threadedData->handshakes[thread - 1], HANDSHAKE_BELOW);
+        }
+
+        if (thread < lastThread) {
+            postHandshake(&threadedData->handshakes[thread + 1], HANDSHAKE_ABOVE);
+        }
+
+        Handshake *ourHandshake = &threadedData->handshakes[thread];
+
+        uint32_t expected = (thread > 0 ? HANDSHAKE_ABOVE : 0) | (thread < lastThread ? HANDSHAKE_BELOW : 0),
+                seen = 0;
+
+        //We don't have to wait for both neighbours to solve the conflicts
+        //Solve the conflicts of each one as soon as it's done
+        while (seen != expected) {
+            uint32_t arrived = waitForHandshake(ourHandshake, seen), done = arrived & ~seen;
+
+            if (done & HANDSHAKE_ABOVE) {
+                //Since we are bellow the thread that is above us (Who knew?)
+                //We get the conflicts of that thread with the thread bellow it (That's us!)
+                Conflicts *topConf = threadedData->conflictPerThreads[thread - 1];
+
+                handleConflicts(conflictData, topConf->bellowCount, topConf->bellow);
+            }
 
-            Conflicts *conflicts = threadedData->conflictPerThreads[topThread];
-//            printf("Thread %d called handle conflicts with thread %d\n", conflictData->threadNum,  conflictData->threadNum - 1);
+            if (done & HANDSHAKE_BELOW) {
+                //Since we are above the thread that is bellow us (Again, who knew? :))
+                //We get the conflicts of that thread with the thread above it (That's us again!)
+                Conflicts *botConf = threadedData->conflictPerThreads[thread + 1];
 
-            handleConflicts(conflictData, conflicts->bellowCount, conflicts->bellow);
+                handleConflicts(conflictData, botConf->aboveCount, botConf->above);
+            }
+
+            seen = arrived;
         }
+
+        //The neighbours can't post again before every thread is past the barrier that follows this phase
+        __atomic_store_n(&ourHandshake->arrived, 0, __ATOMIC_RELAXED);
     }
 }
 
@@ -267,7 +687,7 @@ static void postForNextThread(int threadNumber, InputData *data, struct Threaded
 
     //Wait until all the threads are done
     //Because the last thread calculates the thread balance, we can instantly start a new generation
-    pthread_barrier_wait(&threadedData->barrier);
+    waitAtTreeBarrier(&threadedData->barrier, threadNumber);
 
     //printf("Passed the barrier! Thread %d\n", threadNumber);
 }
@@ -292,7 +712,7 @@ void calculateAccumulatedEntitiesForThread(int threadNumber, InputData *inputDat
 
     for (int row = startRow; row <= endRow; row++) {
         inputData->entitiesAccumulatedPerRow[row] =
-                inputData->entitiesAccumulatedPerRow[row - 1] + inputData->entitiesPerRow[row];
+                (row > 0 ? inputData->entitiesAccumulatedPerRow[row - 1] : 0) + inputData->entitiesPerRow[row];
     }
 
     if (threadNumber == inputData->threads - 1) {
@@ -303,71 +723,84 @@ void calculateAccumulatedEntitiesForThread(int threadNumber, InputData *inputDat
 }
 
 
-void postAndWaitForSurrounding(int threadNumber, InputData *data, struct ThreadedData *threadedData) {
-
-    if (data->threads < 2) return;
+void calculateTilesForThread(int threadNumber, InputData *inputData, ThreadRowData *threadRowData,
+                             struct ThreadedData *threadedData) {
 
-    sem_t *our_sem = &threadedData->threadSemaphores[threadNumber];
-
-    if (threadNumber > 0 && threadNumber < (data->threads - 1)) {
-        //If we're a middle thread, we will have to post for 2 threads
-        sem_post(our_sem);
+    //A single thread splits the world, once every tile has been counted
+    if (waitAtTreeBarrier(&threadedData->barrier, threadNumber)) {
+        calculateOptimalTileBalance(inputData->threads, threadRowData, inputData);
     }
 
-//    printf("Posted to sem %d\n", threadNumber);
+    //No thread can start on its new tile before the tiles are all calculated
+    waitAtTreeBarrier(&threadedData->barrier, threadNumber);
+}
 
-    sem_post(our_sem);
+/*
+ * Only which rows are taken goes through the deques, the worlds are synchronized by the barriers between the phases
+ */
+void fillRowDeque(int threadNumber, int startRow, int endRow, struct ThreadedData *threadedData) {
+    __atomic_store_n(&threadedData->rowDeques[threadNumber], (uint64_t) startRow << 32 | (uint32_t) (endRow + 1),
+                     __ATOMIC_RELAXED);
+}
 
-    int val = 0;
+/**
+ * Take chunkRows rows from the front (Or the back) of the rows left in the deque
+ *
+ * @return 0 if there are no rows left
+ */
+static int takeFromDeque(uint64_t *deque, int fromFront, int chunkRows, int *startRow, int *endRow) {
 
-    sem_getvalue(our_sem, &val);
+    uint64_t current = __atomic_load_n(deque, __ATOMIC_RELAXED), taken;
 
-    //printf("Thread %d entered post and wait %p value: %d\n", threadNumber, our_sem, val);
+    int first, end;
 
-    if (threadNumber == 0) {
-        sem_t *botSem = &threadedData->threadSemaphores[threadNumber + 1];
+    do {
+        first = (int) (current >> 32);
+        end = (int) (uint32_t) current;
 
-        // printf("Thread %d Waiting for bot_sem %d\n", threadNumber, threadNumber + 1);
+        if (first >= end) return 0;
 
-        sem_getvalue(botSem, &val);
+        if (fromFront) {
+            *startRow = first;
+            *endRow = first + chunkRows < end ? first + chunkRows - 1 : end - 1;
 
-        //printf("Sem %d %p value: %d\n", threadNumber + 1, botSem, val);
-        sem_wait(botSem);
+            taken = (uint64_t) (*endRow + 1) << 32 | (uint32_t) end;
+        } else {
+            *startRow = end - chunkRows > first ? end - chunkRows : first;
+            *endRow = end - 1;
 
-        //printf("Thread %d unlocked.\n", threadNumber);
-    } else if (threadNumber > 0 && threadNumber < (data->threads - 1)) {
+            taken = (uint64_t) first << 32 | (uint32_t) *startRow;
+        }
 
-        sem_t *botSem = &threadedData->threadSemaphores[threadNumber + 1],
-                *topSem = &threadedData->threadSemaphores[threadNumber - 1];
+        //The owner and the thieves both take rows from the same word, so the rows taken by each never overlap
+    } while (!__atomic_compare_exchange_n(deque, &current, taken, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
 
+    return 1;
+}
 
-        //printf("Thread %d Waiting for top sem,...\n", threadNumber);
-        sem_getvalue(topSem, &val);
-        //printf("Thread %d Sem %d %p value: %d\n", threadNumber, threadNumber - 1, botSem, val);
-        sem_wait(topSem);
+int takeRowChunk(int threadNumber, int chunkRows, int *startRow, int *endRow, struct ThreadedData *threadedData) {
+    //The owner goes through its rows from the top, so the rows it reads are still in the cache from the last chunk
+    return takeFromDeque(&threadedData->rowDeques[threadNumber], 1, chunkRows, startRow, endRow);
+}
 
-        //printf("Thread %d unlocked top.\n", threadNumber);
-        //printf("Thread %d Waiting for bot_sem\n", threadNumber);
-        sem_getvalue(botSem, &val);
-        //printf("Thread %d Sem %d %p value: %d\n", threadNumber, threadNumber + 1, botSem, val);
-        sem_wait(botSem);
-        //printf("Thread %d unlocked bot. (UNLOCKED)\n", threadNumber);
-    } else {
-        sem_t *topSem = &threadedData->threadSemaphores[threadNumber - 1];
+int stealRowChunk(int threadNumber, int threadCount, int chunkRows, int *startRow, int *endRow,
+                  struct ThreadedData *threadedData) {
 
-        //printf("Thread %d Waiting for top_sem %d\n", threadNumber, threadNumber - 1);
-        sem_getvalue(topSem, &val);
+    for (int offset = 1; offset < threadCount; offset++) {
+        int victim = (threadNumber + offset) % threadCount;
 
-        //printf("Thread %d Sem %d %p value: %d\n", threadNumber, threadNumber - 1, &topSem, val);
-        sem_wait(topSem);
-        // printf("Unlock thread %d\n", threadNumber);
+        //Thieves take from the bottom, as far away as possible from the rows the owner is working on
+        if (takeFromDeque(&threadedData->rowDeques[victim], 0, chunkRows, startRow, endRow)) {
+            return 1;
+        }
     }
 
+    return 0;
 }
 
 void freeConflicts(Conflicts *conflicts) {
-    free(conflicts->above);
-    free(conflicts->bellow);
+    freePages(conflicts->above);
+    freePages(conflicts->bellow);
 
     free(conflicts);
 }
@@ -377,14 +810,16 @@ void freeThreadData(int threads, struct ThreadedData *data) {
     for (int thread = 0; thread < threads; thread++) {
         freeConflicts(data->conflictPerThreads[thread]);
 
-        sem_destroy(&data->threadSemaphores[thread]);
+        sem_destroy(&data->precedingSemaphores[thread]);
     }
     free(data->conflictPerThreads);
 
-    free(data->threadSemaphores);
+    free(data->precedingSemaphores);
     free(data->threads);
+    free(data->rowDeques);
+    free(data->handshakes);
 
-    pthread_barrier_destroy(&data->barrier);
+    freeTreeBarrier(&data->barrier);
 
     free(data);
 }
\ No newline at end of file
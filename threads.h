@@ -5,14 +5,14 @@
 #include "linkedlist.h"
 #include "semaphore.h"
 #include "rabbitsandfoxes.h"
+#include "entity_index.h"
 
 typedef struct Conflict_ {
 
     int newRow, newCol;
 
-    SlotContent slotContent;
-
-    void *data;
+    //A copy of the entity that is moving, already updated for this generation
+    EntityInfo entity;
 
 } Conflict;
 
@@ -28,55 +28,228 @@ typedef struct Conflicts_ {
 
     Conflict *bellow;
 
+    //The amount of conflicts each list has room for (The columns of a row)
+    int capacity;
+
 } Conflicts;
 
 
+/**
+ * How long a thread has waited for the threads next to it (In the conflict handshakes and for their phases)
+ */
+typedef struct HandshakeCounters_ {
+
+    //Time spent checking for the neighbours before going to sleep, and asleep
+    long long spinNanos, blockNanos;
+
+    //The waits that ended while spinning, and the ones that had to sleep
+    long long spins, blocks;
+
+} HandshakeCounters;
+
+/**
+ * What the threads next to a thread wait on, in its own cache line
+ */
+typedef struct Handshake_ {
+
+    //The neighbours that are done with the phase (HANDSHAKE_ABOVE, HANDSHAKE_BELOW) and if the thread is asleep
+    //waiting for them (HANDSHAKE_SLEEPING). It's the futex the thread sleeps on
+    uint32_t arrived;
+
+    //The amount of phases the thread is done with since the start of the run, shifted left by one. The lowest bit is
+    //set when other threads are asleep waiting for it to be done with a phase (See waitForNeighbourPhases)
+    uint32_t phases;
+
+    HandshakeCounters counters;
+
+} __attribute__((aligned(64))) Handshake;
+
+//The amount of threads right under each thread in the tree of a TreeBarrier
+#define TREE_BARRIER_FAN_IN 4
+
+/**
+ * The flags of a thread in a TreeBarrier, in its own cache line
+ */
+typedef struct TreeBarrierNode_ {
+
+    //The sense of the last episode the thread (And every thread under it in the tree) arrived at. The second bit is
+    //set when the thread above it is asleep waiting for it. For the release node, it's what every thread waits on
+    uint32_t arrived;
+
+    //The sense of the episode the thread is in, only used by the thread itself
+    uint32_t sense;
+
+} __attribute__((aligned(64))) TreeBarrierNode;
+
+/**
+ * A sense reversing barrier where the threads arrive through a tree, TREE_BARRIER_FAN_IN threads at each node: a
+ * thread waits for the threads under it before letting the thread above it know, so every arrival flag has one writer
+ * and one waiter. Thread 0, at the root, then releases all of them at once. Unlike pthread_barrier_t, no thread
+ * waits on a lock to arrive
+ */
+typedef struct TreeBarrier_ {
+
+    int threads;
+
+    //How many times a thread checks its flags before going to sleep
+    int spins;
+
+    //A node for each thread, and the node the threads wait on to be released after them
+    TreeBarrierNode *nodes, *release;
+
+} TreeBarrier;
+
+void initTreeBarrier(TreeBarrier *barrier, int threads);
+
+/**
+ * Wait for every thread of the barrier to arrive at it. Each thread must use its own threadNumber (0 to threads - 1)
+ *
+ * @return 1 in a single thread (Thread 0), like PTHREAD_BARRIER_SERIAL_THREAD, 0 in the others
+ */
+int waitAtTreeBarrier(TreeBarrier *barrier, int threadNumber);
+
+void freeTreeBarrier(TreeBarrier *barrier);
+
 struct ThreadedData {
     Conflicts **conflictPerThreads;
 
     pthread_t *threads;
 
-    sem_t *threadSemaphores, *precedingSemaphores;
+    sem_t *precedingSemaphores;
+
+    TreeBarrier barrier;
+
+    Handshake *handshakes;
 
-    pthread_barrier_t barrier;
+    //The rows each thread has left in a phase of the stealing engine, packed as the first row in the upper half of
+    //the word and the row after the last one in the lower half (See takeRowChunk)
+    uint64_t *rowDeques;
 };
 
 struct ThreadConflictData {
 
     int threadNum;
 
+    int genNumber;
+
     int startRow, endRow;
 
     InputData *inputData;
 
-    WorldSlot *world;
+    World *world;
 
     struct ThreadedData *threadedData;
+
+    //The index of the entities in world, where the entities moved in by the conflicts are added
+    EntityList *entities;
 };
 
+/*
+ * The columns of the tiles of the tiled engine are cut at multiples of a word of the occupancy summary (64 words of
+ * 64 slots), so every word of the bit planes and of the summary is only written by a single thread
+ */
+#define TILE_BLOCK_WORDS 64
+
+#define TILE_BLOCK_COLUMNS (TILE_BLOCK_WORDS * 64)
+
 typedef struct ThreadRowData_ {
 
     int startRow, endRow;
 
+    //The words of the bit planes of each row that are the thread's (Every word of the row, except in the tiled engine)
+    int startWord, endWord;
+
 } ThreadRowData;
 
 void initThreadData(int threadCount, InputData *data, struct ThreadedData *destination);
 
-void postAndWaitForSurrounding(int threadNumber, InputData *data, struct ThreadedData *threadedData);
+/**
+ * Get threadedData (Initialized for at least threadCount threads) ready for another run, with threadCount threads
+ * on the world of data. The semaphores of the rebalance (precedingSemaphores), the handshakes and the conflict lists
+ * are kept, the handshakes are cleared and the lists only grow if the rows of the world are longer than the ones they
+ * were made for. The barrier is only made again if the amount of threads changed
+ */
+void reuseThreadData(int threadCount, InputData *data, struct ThreadedData *threadedData);
 
-void initAndAppendConflict(Conflicts *conflicts, int above, int newRow, int newCol, WorldSlot *slot);
+void initAndAppendConflict(Conflicts *conflicts, int above, int newRow, int newCol, EntityInfo *entity);
 
 int verifyThreadInputs(InputData *inputData);
 
 void calculateOptimalThreadBalance(int threadCount, ThreadRowData *threadDatas, InputData *inputData);
 
+/**
+ * Split the world into a tile for each thread, with about the same amount of entities in each one (Counted with
+ * entitiesPerBlock). The columns are cut into bands first, and then the rows of each band are cut like the strips of
+ * calculateOptimalThreadBalance, between the threads of the band.
+ *
+ * Also counts the entities of each row (entitiesPerRow and entitiesAccumulatedPerRow) from the blocks
+ */
+void calculateOptimalTileBalance(int threadCount, ThreadRowData *threadDatas, InputData *inputData);
+
 void synchronizeThreadAndSolveConflicts(struct ThreadConflictData *conflictData);
 
 void calculateAccumulatedEntitiesForThread(int threadNumber, InputData *inputData, ThreadRowData *threadRowData,
                                            struct ThreadedData *threadedData);
 
+/**
+ * Wait for every thread to be done with its tile, and split the world into new tiles for the next generation
+ */
+void calculateTilesForThread(int threadNumber, InputData *inputData, ThreadRowData *threadRowData,
+                             struct ThreadedData *threadedData);
+
+/**
+ * Give the thread the rows between startRow and endRow for the next phase of the stealing engine
+ */
+void fillRowDeque(int threadNumber, int startRow, int endRow, struct ThreadedData *threadedData);
+
+/**
+ * Take the first chunkRows rows (Or less, if there aren't that many left) the thread has left
+ *
+ * @return 0 if the thread has no rows left
+ */
+int takeRowChunk(int threadNumber, int chunkRows, int *startRow, int *endRow, struct ThreadedData *threadedData);
+
+/**
+ * Take the last chunkRows rows one of the other threads has left, looking at the threads after ours first
+ *
+ * @return 0 if no thread has any rows left
+ */
+int stealRowChunk(int threadNumber, int threadCount, int chunkRows, int *startRow, int *endRow,
+                  struct ThreadedData *threadedData);
+
 void clearConflictsForThread(int thread, struct ThreadedData *threadedData);
 
+/**
+ * Let the threads next to ours know we're done with another phase
+ */
+void finishPhase(int threadNumber, struct ThreadedData *threadedData);
+
+/**
+ * Set the counter of phases (Shifted left by one, like Handshake.phases) to phase, which can't be lower than the one
+ * it had, and wake up the threads asleep waiting for it
+ */
+void publishPhase(uint32_t *phases, uint32_t phase);
+
+/**
+ * Wait for the counter of phases to reach phase: spin for a while, in case it's about to, and then sleep on the futex
+ * until publishPhase (Or finishPhase) wakes us up. The waits are added to counters, unless it's NULL
+ */
+void waitForPhase(uint32_t *phases, uint32_t phase, HandshakeCounters *counters);
+
+/**
+ * Wait for every thread with rows less than reach rows away from ours to be done with the phases before phase (The
+ * first phase of the run is 0), instead of waiting for every thread at a barrier
+ */
+void waitForNeighbourPhases(int threadNumber, int phase, int reach, InputData *inputData, ThreadRowData *threadRowData,
+                            struct ThreadedData *threadedData);
+
+/**
+ * Add up the handshake counters of the threads
+ */
+void sumHandshakeCounters(int threadCount, struct ThreadedData *threadedData, HandshakeCounters *destination);
+
+void printHandshakeCounters(FILE *outputFile, HandshakeCounters *counters);
+
 void freeConflict(Conflict *);
 
 void freeThreadData(int threads, struct ThreadedData *free);